@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "alarm.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/* glibc before 2.35 doesn't name it */
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+
+namespace {
+
+    const long interval = 10;	/* ms */
+    const long grace = 100;	/* ms, for an interrupted probe to notice */
+
+    void nothing(int) {}
+
+    void install(int sig)
+    {
+	struct sigaction sa {};
+	sa.sa_handler = nothing;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;		/* no SA_RESTART */
+	sigaction(sig, &sa, nullptr);
+    }
+
+    timespec ms(long n)
+    {
+	return {n / 1000, n % 1000 * 1000000};
+    }
+
+    /**
+     * The calling thread's timer, signalling that thread only.
+     */
+    struct Timer {
+	Timer();
+	~Timer();
+	timer_t id;
+	bool ok;
+    };
+
+    Timer::Timer()
+    {
+	static std::once_flag once;
+	std::call_once(once, install, SIGRTMIN);
+
+	sigevent ev {};
+	ev.sigev_notify = SIGEV_THREAD_ID;
+	ev.sigev_signo = SIGRTMIN;
+	ev.sigev_notify_thread_id = syscall(SYS_gettid);
+	ok = timer_create(CLOCK_MONOTONIC, &ev, &id)==0;
+    }
+
+    Timer::~Timer()
+    {
+	if (ok) timer_delete(id);
+    }
+
+    Timer& timer()
+    {
+	static thread_local Timer t;
+	return t;
+    }
+}
+
+
+Alarm::Alarm(unsigned n)
+{
+    if (!n) return;
+    Timer& t = timer();
+    if (!t.ok) return;
+
+    itimerspec its {ms(interval), ms(n)};
+    armed = timer_settime(t.id, 0, &its, nullptr)==0;
+}
+
+Alarm::~Alarm()
+{
+    if (!armed) return;
+    const itimerspec its {};
+    timer_settime(timer().id, 0, &its, nullptr);
+}
+
+
+struct Runner::State {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::function<void()> job;
+    bool quit = false;
+};
+
+Runner::~Runner()
+{
+    if (!thread.joinable()) return;
+    {
+	std::lock_guard<std::mutex> lock {state->mutex};
+	state->quit = true;
+	state->cond.notify_one();
+    }
+    thread.join();
+}
+
+/**
+ * Give 'job' to the thread, starting one if there's none.  False if
+ * that's not possible.
+ */
+bool Runner::start(const std::function<void()>& job)
+{
+    if (!thread.joinable()) {
+	state = std::make_shared<State>();
+	try {
+	    thread = std::thread {&Runner::loop, state};
+	}
+	catch (const std::system_error&) {
+	    state.reset();
+	    return false;
+	}
+    }
+
+    std::lock_guard<std::mutex> lock {state->mutex};
+    state->job = job;
+    state->cond.notify_one();
+    return true;
+}
+
+/**
+ * Leave the thread to its job, and to end when (if) it's done.
+ */
+void Runner::abandon()
+{
+    {
+	std::lock_guard<std::mutex> lock {state->mutex};
+	state->quit = true;
+    }
+    thread.detach();
+    state.reset();
+}
+
+std::chrono::milliseconds Runner::patience(unsigned ms)
+{
+    return std::chrono::milliseconds {ms + grace};
+}
+
+/**
+ * The thread: run jobs until told to quit.  The State is shared, so
+ * that an abandoned thread has it after the Runner is gone.
+ */
+void Runner::loop(std::shared_ptr<State> state)
+{
+    std::unique_lock<std::mutex> lock {state->mutex};
+    while (true) {
+	state->cond.wait(lock, [&state] { return state->job || state->quit; });
+	if (!state->job) return;
+	const auto job = std::move(state->job);
+	state->job = nullptr;
+	lock.unlock();
+	job();
+	lock.lock();
+    }
+}
@@ -0,0 +1,104 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_ALARM_H
+#define ANYDIM_ALARM_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+/**
+ * Interrupting a thread which is stuck in a system call, like an
+ * open(2) or read(2) on a hung NFS mount, so that probe() gets a
+ * chance to notice that its Options::timeout has passed.
+ *
+ * While an Alarm lives, the calling thread gets a signal (with a
+ * do-nothing handler, installed without SA_RESTART) after 'ms'
+ * milliseconds, and then every few milliseconds until the Alarm
+ * dies.  The repetition is so that a signal which arrives just before
+ * a system call blocks isn't lost.
+ *
+ * Each thread has its own POSIX timer, created on first use.  With
+ * 'ms' zero, or if there's no timer, the Alarm does nothing.
+ *
+ * Note that a system call in uninterruptible sleep isn't interrupted
+ * by anything; for that there's the Runner.
+ */
+class Alarm {
+public:
+    explicit Alarm(unsigned ms);
+    ~Alarm();
+    Alarm(const Alarm&) = delete;
+    Alarm& operator= (const Alarm&) = delete;
+
+private:
+    bool armed = false;
+};
+
+/**
+ * A thread to probe on, which can be given up on.  Hard-mounted NFS
+ * is the typical case: with the server gone, open(2) and read(2)
+ * sleep uninterruptibly, and may never return.
+ *
+ * run() hands 'f' to the Runner's thread, with an Alarm of 'ms'
+ * milliseconds armed while it runs, and waits for its result.  If
+ * it's not there shortly after that, run() returns false, and the
+ * thread is abandoned: left to finish (or not) on its own, while a
+ * new thread takes over the next run().  So 'f' mustn't refer to
+ * anything on the caller's stack.
+ *
+ * With 'ms' zero, or if no thread can be started, 'f' runs in the
+ * calling thread.
+ */
+class Runner {
+public:
+    Runner() = default;
+    ~Runner();
+    Runner(const Runner&) = delete;
+    Runner& operator= (const Runner&) = delete;
+
+    template <class T>
+    bool run(unsigned ms, const std::function<T()>& f, T& t);
+
+private:
+    struct State;
+    std::shared_ptr<State> state;
+    std::thread thread;
+
+    bool start(const std::function<void()>& job);
+    void abandon();
+    static std::chrono::milliseconds patience(unsigned ms);
+    static void loop(std::shared_ptr<State> state);
+};
+
+template <class T>
+bool Runner::run(unsigned ms, const std::function<T()>& f, T& t)
+{
+    if (!ms) {
+	t = f();
+	return true;
+    }
+
+    auto task = std::make_shared<std::packaged_task<T()>>([ms, f] {
+							      Alarm alarm {ms};
+							      return f();
+							  });
+    std::future<T> result = task->get_future();
+    if (!start([task] { (*task)(); })) {
+	(*task)();
+    }
+    else if (result.wait_for(patience(ms))!=std::future_status::ready) {
+	abandon();
+	return false;
+    }
+    t = result.get();
+    return true;
+}
+
+#endif
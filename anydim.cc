@@ -1,6 +1,6 @@
 /* $Id: anydim.cc,v 1.25 2011-01-06 19:48:19 grahn Exp $
  *
- * Copyright (c) 2010, 2011 Jrgen Grahn
+ * Copyright (c) 2010, 2011 Jörgen Grahn
  * All rights reserved.
  *
  */
@@ -8,8 +8,10 @@
 #include "jfif.h"
 #include "tiff/tiff.h"
 #include "orientation.h"
+#include "memo.h"
 
 #include <algorithm>
+#include <limits>
 
 
 namespace {
@@ -31,9 +33,9 @@ namespace {
 	return n;
     }
 
-    bool is_sof(const jfif::Segment& seg)
+    bool sof_marker(unsigned marker)
     {
-	switch(seg.marker) {
+	switch(marker) {
 	case jfif::marker::SOF0:
 	case jfif::marker::SOF1:
 	case jfif::marker::SOF2:
@@ -45,6 +47,11 @@ namespace {
 	}
     }
 
+    bool is_sof(const jfif::Segment& seg)
+    {
+	return sof_marker(seg.marker);
+    }
+
     bool is_app1(const jfif::Segment& seg)
     {
 	return seg.marker == jfif::marker::APP1;
@@ -71,43 +78,76 @@ JpegDim::~JpegDim()
 
 /**
  * Consume another chunk of data, [a, b).
+ *
+ * The decoder is fed a segment's data at a time, and the octets
+ * inbetween one at a time, so that we decide right at the end of
+ * the SOFn segment, and know how much of the chunk was unused.
+ *
+ * Most non-JPEG data is rejected right away by its lack of a SOI
+ * marker; the decoder would notice too, but by throwing, and a
+ * thrown exception costs a memory allocation.
  */
 void JpegDim::feed(const uint8_t *a, const uint8_t *b)
 {
     if(state_==BAD) return;
 
+    for(const uint8_t* p = a; soi < 2 && p!=b; p++, soi++) {
+	const unsigned ch = soi ? jfif::marker::SOI : 0xff;
+	if(*p != ch) {
+	    state_ = BAD;
+	    return;
+	}
+    }
+
     try {
-	decoder->feed(a, b);
-	auto sof = std::find_if(begin(decoder->v), end(decoder->v), is_sof);
-	if(sof!=end(decoder->v)) {
-	    const uint8_t* a = sof->v.data();
-	    const auto b = a + sof->v.size();
-	    if(b-a < 5) {
-		state_ = BAD;
-	    }
-	    else {
-		a++;
-		height = eat16(a);
-		width = eat16(a);
-		state_ = GOOD;
-
-		if (!use_exif) return;
-
-		/* To avoid scanning the whole JFIF in case there's no
-		 * EXIF information, we assume that APP1 appears
-		 * before SOFn.
-		 */
-		auto app1 = std::find_if(begin(decoder->v), end(decoder->v), is_app1);
-		if(app1==end(decoder->v)) return;
-
-		const tiff::File tiff {app1->v};
-		Orientation{tiff}.adjust(width, height);
-	    }
+	while(state_==UNDECIDED && a!=b) {
+	    const size_t n = std::max(decoder->skippable(), size_t(1));
+	    const uint8_t* const c = a + std::min(n, size_t(b-a));
+	    const size_t segments = decoder->v.size();
+	    decoder->feed(a, c);
+	    a = c;
+	    if(decoder->v.size()!=segments) decide();
 	}
+	unused_ = b-a;
     }
     catch (const jfif::Decoder::Error&) {
 	state_ = BAD;
     }
+}
+
+/**
+ * Decide, if the decoder has found a SOFn segment.
+ */
+void JpegDim::decide()
+{
+    auto sof = std::find_if(begin(decoder->v), end(decoder->v), is_sof);
+    if(sof==end(decoder->v)) return;
+
+    const uint8_t* a = sof->v.data();
+    const auto b = a + sof->v.size();
+    if(b-a < 5) {
+	state_ = BAD;
+	return;
+    }
+
+    a++;
+    height = eat16(a);
+    width = eat16(a);
+    state_ = GOOD;
+
+    if (!use_exif) return;
+
+    /* To avoid scanning the whole JFIF in case there's no
+     * EXIF information, we assume that APP1 appears
+     * before SOFn.
+     */
+    auto app1 = std::find_if(begin(decoder->v), end(decoder->v), is_app1);
+    if(app1==end(decoder->v)) return;
+
+    try {
+	const tiff::File tiff {app1->v};
+	Orientation{tiff}.adjust(width, height);
+    }
     catch (const tiff::Error&) {
 	// If TIFF/Exif is broken, we can just ignore it
     }
@@ -124,6 +164,33 @@ void JpegDim::eof()
     }
 }
 
+/**
+ * The rest of the current segment is skippable, unless it's one we
+ * need to decide.
+ */
+size_t JpegDim::skippable() const
+{
+    if(state_!=UNDECIDED) return 0;
+
+    const unsigned marker = decoder->marker();
+    if(!marker || sof_marker(marker)) return 0;
+    if(use_exif && marker==jfif::marker::APP1) return 0;
+    return decoder->skippable();
+}
+
+void JpegDim::skip(size_t n)
+{
+    if(state_!=UNDECIDED) return;
+    decoder->skip(n);
+}
+
+void JpegDim::reset()
+{
+    Dim::reset();
+    decoder->reset();
+    soi = 0;
+}
+
 
 using anydim::PngDim;
 
@@ -160,6 +227,14 @@ void PngDim::feed(const uint8_t *a, const uint8_t *b)
     }
 
     if(b-a < int(sizeof pngintro + 4 + 4)) {
+	/* Reject early if we can, so we don't stand in the way
+	 * of other decoders skipping data.
+	 */
+	const auto n = std::min(b-a, std::ptrdiff_t(sizeof pngintro));
+	if(!std::equal(a, a+n, pngintro)) {
+	    state_ = BAD;
+	    return;
+	}
 	mem_.insert(mem_.end(), a, b);
 	return;
     }
@@ -173,6 +248,7 @@ void PngDim::feed(const uint8_t *a, const uint8_t *b)
     a += sizeof pngintro;
     width = eat32(a);
     height = eat32(a);
+    unused_ = b-a;
 }
 
 void PngDim::eof()
@@ -180,15 +256,35 @@ void PngDim::eof()
     if(state_==UNDECIDED) state_ = BAD;
 }
 
+size_t PngDim::want() const
+{
+    if(state_!=UNDECIDED) return 0;
+    return sizeof pngintro + 4 + 4 - mem_.size();
+}
+
+void PngDim::reset()
+{
+    Dim::reset();
+    mem_.clear();
+}
+
 
 using anydim::AnyDim;
 
-AnyDim::AnyDim(bool use_exif)
-    : mime_("image")
+AnyDim::AnyDim(bool use_exif, uint64_t limit, Memo* memo, unsigned nesting)
+    : mime_("image"),
+      limit_(limit),
+      offset_(0),
+      memo_(memo),
+      trace_(memo? new Trace: nullptr),
+      use_exif_(use_exif)
 {
     dims_.push_back(new JpegDim {use_exif});
     dims_.push_back(new PngDim);
     dims_.push_back(new PnmDim);
+    if(nesting) {
+	dims_.push_back(new CompressedDim {use_exif, limit, nesting - 1});
+    }
 }
 
 
@@ -210,6 +306,7 @@ namespace {
 AnyDim::~AnyDim()
 {
     std::for_each(dims_.begin(), dims_.end(), del);
+    delete trace_;
 }
 
 
@@ -221,9 +318,47 @@ const char* AnyDim::mime() const
 
 void AnyDim::feed(const uint8_t *a, const uint8_t *b)
 {
+    if(uint64_t(b-a) > left()) b = a + left();
+    const bool undecided = state_==UNDECIDED;
+    if(undecided && recall(a, b)) return;
+
+    offset_ += b-a;
     std::for_each(dims_.begin(), dims_.end(),
 		  ::feed(a, b));
     weed();
+    if(state_==UNDECIDED && !left()) state_ = BAD;
+
+    if(undecided && state_==GOOD && trace_ && trace_->on) {
+	memo_->insert(*trace_, {mime_, width, height, offset_ - unused_});
+    }
+}
+
+/**
+ * Add [a, b) to the trace, and if the memo has a header it now
+ * starts with, decide on that.
+ */
+bool AnyDim::recall(const uint8_t *a, const uint8_t *b)
+{
+    if(!trace_ || !trace_->on) return false;
+
+    auto& head = trace_->head;
+    const size_t from = head.size();
+    if(from + (b-a) > Memo::most) {
+	trace_->on = false;
+	return false;
+    }
+    head.insert(head.end(), a, b);
+
+    Memo::Answer answer;
+    if(!memo_->find(*trace_, from, answer)) return false;
+
+    offset_ += b-a;
+    state_ = GOOD;
+    mime_ = answer.mime;
+    width = answer.width;
+    height = answer.height;
+    unused_ = head.size() - answer.length;
+    return true;
 }
 
 void AnyDim::eof()
@@ -234,6 +369,74 @@ void AnyDim::eof()
     if(state_==UNDECIDED) state_ = BAD;
 }
 
+size_t AnyDim::skippable() const
+{
+    const size_t none = std::numeric_limits<size_t>::max();
+    size_t n = none;
+    for(const Dim* dim : dims_) {
+	if(!dim->bad()) n = std::min(n, dim->skippable());
+    }
+    if(n==none) return 0;
+    return std::min(uint64_t(n), left());
+}
+
+void AnyDim::skip(size_t n)
+{
+    if(n && trace_) trace_->on = false;
+    offset_ += n;
+    for(Dim* dim : dims_) {
+	if(!dim->bad()) dim->skip(n);
+    }
+    if(state_==UNDECIDED && !left()) state_ = BAD;
+}
+
+/**
+ * The most any of the remaining decoders want, but only if all of
+ * them know.  With a limit, we never want more than what's left.
+ */
+size_t AnyDim::want() const
+{
+    size_t n = 0;
+    for(const Dim* dim : dims_) {
+	if(dim->bad()) continue;
+	const size_t m = dim->want();
+	if(!m) {
+	    n = 0;
+	    break;
+	}
+	n = std::max(n, m);
+    }
+    if(!limit_) return n;
+    if(!n || n > left()) return left();
+    return n;
+}
+
+void AnyDim::reset()
+{
+    Dim::reset();
+    for(Dim* dim : dims_) dim->reset();
+    mime_ = "image";
+    offset_ = 0;
+    if(trace_) trace_->reset();
+}
+
+/**
+ * True if there's a limit, and we've reached it.
+ */
+bool AnyDim::limited() const
+{
+    return limit_ && !left();
+}
+
+/**
+ * How many octets there are left until the limit, if there is one.
+ */
+uint64_t AnyDim::left() const
+{
+    if(!limit_) return std::numeric_limits<uint64_t>::max();
+    return limit_ > offset_? limit_ - offset_: 0;
+}
+
 void AnyDim::weed()
 {
     Dim* last_good = 0;
@@ -261,5 +464,6 @@ void AnyDim::weed()
 	width = last_good->width;
 	height = last_good->height;
 	mime_ = last_good->mime();
+	unused_ = last_good->unused();
     }
 }
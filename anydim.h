@@ -3,7 +3,7 @@
  *
  * anydim - print width and height of images
  *
- * Copyright (c) 2011 Jrgen Grahn
+ * Copyright (c) 2011 Jörgen Grahn
  * All rights reserved.
  *
  */
@@ -21,7 +21,7 @@ namespace jfif {
 namespace anydim {
 
     /**
-     * Base class for dimension (width  height) decoders for
+     * Base class for dimension (width × height) decoders for
      * different image formats.
      *
      * The decoding is driven by a series of Dim::feed(a, b) followed by
@@ -33,10 +33,24 @@ namespace anydim {
      * Dim::bad() is true or (width, height) is valid.
      *
      * There's also the file's MIME type, available as Dim::mime().
+     *
+     * A decoder may also help plan the reading: Dim::skippable() is
+     * the number of coming octets it doesn't care about, which you
+     * may Dim::skip() rather than read and feed.  Dim::want() is, if
+     * the decoder knows, the most it needs to read before it has
+     * decided.
+     *
+     * Once decided, Dim::unused() is the number of octets at the end
+     * of the last feed which weren't needed for the decision.  A
+     * decoder which doesn't know says 0, i.e. that it needed them
+     * all.
+     *
+     * Dim::reset() makes a decoder ready for another file, as if it
+     * was new, but keeps what it has allocated.
      */
     class Dim {
     public:
-	Dim() : state_(UNDECIDED) {}
+	Dim() : state_(UNDECIDED), unused_(0) {}
 	virtual ~Dim() = default;
 
 	virtual const char* mime() const = 0;
@@ -44,8 +58,15 @@ namespace anydim {
 	virtual void feed(const uint8_t *a, const uint8_t *b) = 0;
 	virtual void eof() = 0;
 
+	virtual size_t skippable() const { return 0; }
+	virtual void skip(size_t) {}
+	virtual size_t want() const { return 0; }
+
+	virtual void reset() { state_ = UNDECIDED; unused_ = 0; }
+
 	bool bad() const { return state_==BAD; }
 	bool undecided() const { return state_==UNDECIDED; }
+	size_t unused() const { return unused_; }
 
 	unsigned width;
 	unsigned height;
@@ -53,6 +74,7 @@ namespace anydim {
     protected:
 	enum State { UNDECIDED, GOOD, BAD };
 	State state_;
+	size_t unused_;
     };
 
 
@@ -74,6 +96,10 @@ namespace anydim {
      * 	   and some googling, and the libjpeg sources.
      *
      * This width x height may be modified by Exif (TIFF?) Orientation.
+     *
+     * Segments other than SOFn and (if we want Exif) APP1 are
+     * skippable: typically ICC profiles in APP2 and Photoshop stuff
+     * in APP13, which can be large.
      */
     class JpegDim final: public Dim {
     public:
@@ -85,9 +111,17 @@ namespace anydim {
 	void feed(const uint8_t *a, const uint8_t *b) override;
 	void eof() override;
 
+	size_t skippable() const override;
+	void skip(size_t n) override;
+
+	void reset() override;
+
     private:
 	jfif::Decoder* const decoder;
 	const bool use_exif;
+	unsigned soi = 0;
+
+	void decide();
     };
 
 
@@ -95,7 +129,8 @@ namespace anydim {
      * PNG dimension decoder.
      *
      * See RFC 2083. The 16 octets before the width and height are
-     * happily fixed and constant. We never bother to parse the rest.
+     * happily fixed and constant. We never bother to parse the rest,
+     * and we never want() more than those 24 octets.
      */
     class PngDim final: public Dim {
     public:
@@ -106,6 +141,10 @@ namespace anydim {
 	void feed(const uint8_t *a, const uint8_t *b) override;
 	void eof() override;
 
+	size_t want() const override;
+
+	void reset() override;
+
     private:
 	std::vector<uint8_t> mem_;
     };
@@ -125,6 +164,8 @@ namespace anydim {
 	void feed(const uint8_t *a, const uint8_t *b) override;
 	void eof() override;
 
+	void reset() override;
+
     private:
 	void feed(char ch);
 	bool comment_;
@@ -133,15 +174,84 @@ namespace anydim {
     };
 
 
+    class AnyDim;
+    class Memo;
+    struct Trace;
+
+    /**
+     * Dimension decoder for compressed images: gzip, xz and (if
+     * built with it) zstd, recognized by their magic numbers.
+     *
+     * The data is decompressed as it's fed, into an AnyDim of its own,
+     * and only as far as that one needs: a huge compressed PPM is
+     * decided after a few hundred octets of output.  What it skips is
+     * decompressed, but not fed.
+     *
+     * That AnyDim has the same 'limit', which then applies to the
+     * decompressed data, and may itself unwrap 'nesting' more levels
+     * of compression.  With zero, it recognizes only plain images, so
+     * a gzip file which decompresses into itself can't recurse
+     * forever.  Likewise, an xz file needing more than 80 MiB to
+     * decompress (more than xz -9 does) is bad rather than a reason
+     * to allocate that much.
+     *
+     * The MIME type is that of the image inside.
+     */
+    class CompressedDim final: public Dim {
+    public:
+	explicit CompressedDim(bool use_exif, uint64_t limit = 0,
+			       unsigned nesting = 0);
+	~CompressedDim();
+
+	const char* mime() const override;
+
+	void feed(const uint8_t *a, const uint8_t *b) override;
+	void eof() override;
+
+	void reset() override;
+
+	class Codec;
+
+    private:
+	const bool use_exif_;
+	const uint64_t limit_;
+	const unsigned nesting_;
+	std::vector<uint8_t> magic_;
+	std::vector<Codec*> codecs_;
+	Codec* codec_;
+	AnyDim* dim_;
+	size_t skip_;
+
+	void start();
+	void pass(const uint8_t *a, const uint8_t *b);
+	void decide();
+    };
+
+
     /**
      * The actual 'any' dimension decoder -- decode using all available
      * decoders in parallel until (presumably) zero or one turns
      * !(undecided || bad).
      *
+     * Octets are skippable if all decoders which aren't bad yet
+     * agree they are.
+     *
+     * With a nonzero 'limit', the dimensions must be found in the
+     * first 'limit' octets of the file; after that, AnyDim turns bad
+     * rather than keep reading.  skippable() and want() never reach
+     * past the limit, and limited() tells if it has been reached.
+     *
+     * With a Memo, a file which starts with a header seen before is
+     * decided without running the decoders, and those decided by the
+     * decoders are added to it.
+     *
+     * Compressed images are recognized if 'nesting' is nonzero, and
+     * then only that many levels deep.
      */
     class AnyDim final: public Dim {
     public:
-	explicit AnyDim(bool use_exif);
+	explicit AnyDim(bool use_exif, uint64_t limit = 0,
+			Memo* memo = nullptr, unsigned nesting = 1);
 	~AnyDim();
 
 	const char* mime() const override;
@@ -149,12 +259,134 @@ namespace anydim {
 	void feed(const uint8_t *a, const uint8_t *b) override;
 	void eof() override;
 
+	size_t skippable() const override;
+	void skip(size_t n) override;
+	size_t want() const override;
+
+	void reset() override;
+
+	bool limited() const;
+
     private:
 	std::vector<Dim*> dims_;
 	const char* mime_;
+	const uint64_t limit_;
+	uint64_t offset_;
+	Memo* const memo_;
+	Trace* const trace_;
+	const bool use_exif_;
 
+	uint64_t left() const;
+	bool recall(const uint8_t *a, const uint8_t *b);
 	void weed();
     };
 
+
+    class Cache;
+
+    /**
+     * A budget for the octets probe() reads, which it takes from
+     * before each read, and which may make it wait.  What read(n)
+     * took but didn't get read after all is given back with unread().
+     */
+    class Budget {
+    public:
+	virtual ~Budget() = default;
+	virtual void read(size_t n) = 0;
+	virtual void unread(size_t n) = 0;
+    };
+
+    /**
+     * Options for probe().
+     *
+     * If 'gentle', try not to disturb the page cache: open the file
+     * with O_NOATIME (if we're allowed to), tell the kernel not to
+     * bother with readahead, and when we're done, tell it we won't
+     * need the data we read again.
+     *
+     * If 'timeout' (in milliseconds) is set, give up with ETIMEDOUT
+     * once it has passed.  probe() itself only notices this between
+     * reads, or when a system call is interrupted by a signal; it's
+     * up to the caller to arrange for such a signal if the storage
+     * may hang, and to give up on a probe which is stuck in a system
+     * call that signals don't interrupt.
+     *
+     * If 'max_octets' is set, that's the AnyDim limit.
+     *
+     * If there's a 'memo', the AnyDims use it.
+     *
+     * If there's a 'budget', the reads are paced by it.
+     *
+     * If there's a 'cache', regular files are looked up there before
+     * they are read, and what's found is remembered.  If 'xattr',
+     * the same goes for the files' own extended attributes.  See
+     * Cache and get_xattr().  If 'thumbnails', files named by a path
+     * are also looked up in the desktop's thumbnail cache; see
+     * get_thumbnail().
+     */
+    struct Options {
+	bool use_exif = true;
+	bool gentle = false;
+	unsigned timeout = 0;
+	uint64_t max_octets = 0;
+	Memo* memo = nullptr;
+	Budget* budget = nullptr;
+	Cache* cache = nullptr;
+	bool xattr = false;
+	bool thumbnails = false;
+    };
+
+    /**
+     * The outcome of probing a file: either an I/O error (an errno
+     * value), or a bad file (not a valid image of any kind we know
+     * of), or the MIME type and dimensions of the image.
+     *
+     * A file which is bad only because the decoding stopped at the
+     * Options' max_octets is also 'limited': it may well be a good
+     * image without the limit.
+     *
+     * There's also some accounting of the work done: the number of
+     * octets and pages read, and how far into the file we got.
+     */
+    struct Result {
+	Result() = default;
+	explicit Result(const Dim& dim);
+
+	int error = 0;
+	bool bad = false;
+	bool limited = false;
+	const char* mime = "image";
+	unsigned width = 0;
+	unsigned height = 0;
+
+	uint64_t octets = 0;
+	uint64_t pages = 0;
+	uint64_t offset = 0;
+
+	void tally(uint64_t offset, size_t n);
+	void decided(const Dim& dim);
+	void decided(const AnyDim& dim);
+    };
+
+    /**
+     * Probe an open file, reading from its current position (if it's
+     * a pipe or similar) or from its beginning, with pread(2).  Reads
+     * no more than necessary, skipping whatever the decoders find
+     * skippable, and doesn't close the file.
+     */
+    Result probe(int fd, const Options& options = Options {});
+
+    /**
+     * Probe a file by name. Like probe(int, const Options&), but the
+     * file is opened and closed for you.
+     */
+    Result probe(const char* path, const Options& options = Options {});
+
+    /**
+     * Probe a file which is in memory, [a, b).  Only 'use_exif',
+     * 'max_octets' and 'memo' of the options matter.
+     */
+    Result probe(const uint8_t* a, const uint8_t* b,
+		 const Options& options = Options {});
 }
 #endif
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "anydim_c.h"
+#include "anydim.h"
+
+#include <new>
+
+#include <errno.h>
+
+
+struct anydim_decoder {
+    explicit anydim_decoder(int flags)
+	: dim {!(flags & ANYDIM_NO_EXIF)}
+    {}
+
+    anydim::AnyDim dim;
+    int error = 0;
+};
+
+
+namespace {
+
+    anydim::Options options(int flags)
+    {
+	anydim::Options options;
+	options.use_exif = !(flags & ANYDIM_NO_EXIF);
+	return options;
+    }
+
+    int put(const anydim::Result& r, anydim_result* res)
+    {
+	res->error = r.error;
+	res->bad = r.bad;
+	res->mime = r.mime;
+	res->width = r.width;
+	res->height = r.height;
+	return r.error || r.bad ? -1 : 0;
+    }
+
+    int failure(int err, anydim_result* res)
+    {
+	anydim::Result r;
+	r.error = err;
+	return put(r, res);
+    }
+}
+
+
+int anydim_probe_fd(int fd, int flags, anydim_result* res)
+{
+    try {
+	return put(anydim::probe(fd, options(flags)), res);
+    }
+    catch (const std::bad_alloc&) {
+	return failure(ENOMEM, res);
+    }
+    catch (...) {
+	return failure(EIO, res);
+    }
+}
+
+int anydim_probe_buffer(const void* buf, size_t len, int flags,
+			anydim_result* res)
+{
+    const auto a = static_cast<const uint8_t*>(buf);
+    try {
+	return put(anydim::probe(a, a + len, options(flags)), res);
+    }
+    catch (const std::bad_alloc&) {
+	return failure(ENOMEM, res);
+    }
+    catch (...) {
+	return failure(EIO, res);
+    }
+}
+
+
+anydim_decoder* anydim_new(int flags)
+{
+    try {
+	return new anydim_decoder {flags};
+    }
+    catch (...) {
+	return nullptr;
+    }
+}
+
+int anydim_feed(anydim_decoder* d, const void* buf, size_t len)
+{
+    if (d->error) return -1;
+    const auto a = static_cast<const uint8_t*>(buf);
+    try {
+	d->dim.feed(a, a + len);
+    }
+    catch (const std::bad_alloc&) {
+	d->error = ENOMEM;
+	return -1;
+    }
+    catch (...) {
+	d->error = EIO;
+	return -1;
+    }
+    return d->dim.undecided() ? 1 : 0;
+}
+
+void anydim_eof(anydim_decoder* d)
+{
+    if (d->error || !d->dim.undecided()) return;
+    try {
+	d->dim.eof();
+    }
+    catch (const std::bad_alloc&) {
+	d->error = ENOMEM;
+    }
+    catch (...) {
+	d->error = EIO;
+    }
+}
+
+/**
+ * An undecided decoder is an error, since it may be decided later.
+ */
+int anydim_get(const anydim_decoder* d, anydim_result* res)
+{
+    if (d->error) return failure(d->error, res);
+    if (d->dim.undecided()) return failure(EAGAIN, res);
+
+    anydim::Result r;
+    r.decided(d->dim);
+    return put(r, res);
+}
+
+void anydim_reset(anydim_decoder* d)
+{
+    d->dim.reset();
+    d->error = 0;
+}
+
+void anydim_free(anydim_decoder* d)
+{
+    delete d;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * A C interface to anydim, for programs in C and for languages which
+ * can call C functions (Go with cgo, Python with ctypes and so on).
+ * It's in libanydim.so.1, whose ABI stays compatible as long as the
+ * soname does.
+ *
+ * All functions may be called from many threads at once; an
+ * incremental decoder must only be used by one thread at a time.
+ * No C++ exceptions escape; an out-of-memory condition is reported
+ * as ENOMEM.
+ */
+#ifndef ANYDIM_C_H
+#define ANYDIM_C_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The outcome of probing an image: 'error' is an errno value if it
+ * couldn't be read, otherwise 0 and 'bad' is nonzero if it isn't a
+ * valid image of a kind we know.  Else 'mime' (a static string) and
+ * the dimensions are valid.
+ */
+struct anydim_result {
+    int error;
+    int bad;
+    const char* mime;
+    unsigned width;
+    unsigned height;
+};
+
+/* Flags */
+#define ANYDIM_NO_EXIF 1	/* ignore Exif orientation in JPEGs */
+
+/*
+ * Probe the open file 'fd' (from its beginning if it's seekable,
+ * otherwise from where it is), or the 'len' octets at 'buf'.
+ * Return 0 if the dimensions were found, otherwise -1; either way
+ * 'res' says what happened.
+ */
+int anydim_probe_fd(int fd, int flags, struct anydim_result* res);
+int anydim_probe_buffer(const void* buf, size_t len, int flags,
+			struct anydim_result* res);
+
+/*
+ * An incremental decoder, for data which arrives a piece at a time.
+ * anydim_feed() returns 1 while the decoder is undecided and wants
+ * more, and 0 once it's decided (or -1 on error, with the result's
+ * 'error' set); anydim_eof() says there's no more.  Then
+ * anydim_get() returns like anydim_probe_fd().
+ *
+ * anydim_reset() makes it ready for another image, keeping its
+ * memory: once a decoder has seen an image of each kind (a JPEG, a
+ * gzipped one and so on) it doesn't allocate anything more.
+ * anydim_new() returns NULL if out of memory.
+ */
+struct anydim_decoder;
+
+struct anydim_decoder* anydim_new(int flags);
+int anydim_feed(struct anydim_decoder* d, const void* buf, size_t len);
+void anydim_eof(struct anydim_decoder* d);
+int anydim_get(const struct anydim_decoder* d, struct anydim_result* res);
+void anydim_reset(struct anydim_decoder* d);
+void anydim_free(struct anydim_decoder* d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
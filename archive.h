@@ -0,0 +1,55 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_ARCHIVE_H
+#define ANYDIM_ARCHIVE_H
+
+#include "anydim.h"
+
+#include <string>
+#include <functional>
+
+namespace anydim {
+
+    /**
+     * What to do with the Result for each member of an archive.
+     */
+    using Member = std::function<void(const std::string& name,
+				      const Result& res)>;
+
+    /**
+     * Probe each regular file in the tar(5) stream 'fd' (ustar, with
+     * the GNU and pax long names) with a fresh AnyDim, and pass the
+     * result to 'member'.
+     *
+     * Only the start of each member is read; the rest is skipped with
+     * lseek(2) or, if 'fd' is a pipe, read and discarded.  The
+     * Options' use_exif and max_octets apply per member.
+     *
+     * Returns 0, an errno for I/O errors, or EINVAL if this isn't a
+     * tar stream after all.
+     */
+    int probe_tar(int fd, const Options& options, const Member& member);
+
+    /**
+     * Probe each file in the ZIP archive 'fd' (including ZIP64, and
+     * things like CBZ, ODF and OOXML which are ZIP inside) with a
+     * fresh AnyDim, and pass the result to 'member'.
+     *
+     * The central directory says where the members are, so each one
+     * costs a pread(2) of its local header and the start of its data,
+     * and more only if the decoders need it.  Stored members are fed
+     * as they are; deflated ones are inflated only until decided.
+     * Encrypted members, and other compression methods, are ENOTSUP.
+     *
+     * 'fd' must be a regular file, or it's ESPIPE.  Returns 0, an
+     * errno for I/O errors, or EINVAL if this isn't a ZIP archive
+     * after all.
+     */
+    int probe_zip(int fd, const Options& options, const Member& member);
+}
+
+#endif
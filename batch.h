@@ -0,0 +1,27 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_BATCH_H
+#define ANYDIM_BATCH_H
+
+#include <string>
+
+/**
+ * A batch of files to probe: something to push() file names onto,
+ * which eventually writes their dimensions somewhere.
+ *
+ * push() may block for a while, if the batch is busy.  join() waits
+ * for all files to be done, and returns false if any of them failed.
+ */
+class Batch {
+public:
+    virtual ~Batch() = default;
+
+    virtual void push(const std::string& file) = 0;
+    virtual bool join() = 0;
+};
+
+#endif
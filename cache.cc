@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "cache.h"
+
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include <cstring>
+#include <ctime>
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+
+using anydim::Cache;
+
+
+struct Cache::Header {
+    char magic[16];
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t reserved[4];
+};
+
+/**
+ * An entry is free while its tag is 0, being written while it's
+ * 'busy', and then holds the key with that hash.  The key's 'exif'
+ * is stored plus one, so that entries from before it was stored
+ * (with a zero there) never match.
+ */
+struct Cache::Entry {
+    uint64_t tag;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t width;
+    uint32_t height;
+    uint32_t used;
+    uint8_t mime;
+    uint8_t bad;
+    uint8_t exif;
+    uint8_t reserved[9];
+};
+
+static_assert(sizeof(Cache::Entry)==64, "an entry is a cache line");
+
+
+namespace {
+
+    const char magic[16] = "anydim cache 1\n";
+    const uint64_t busy = 1;
+    const uint64_t initial = 1 << 20;
+    const unsigned probes = 64;
+
+    /* Don't cache files modified this recently (in nanoseconds); a
+     * change within the same mtime tick would go unnoticed.
+     */
+    const int64_t settle = 2000000000;
+
+    const char* const mimes[] = {
+	"image",
+	"image/jpeg",
+	"image/png",
+	"image/x-portable-bitmap",
+	"image/x-portable-graymap",
+	"image/x-portable-pixmap",
+    };
+    const unsigned nmimes = sizeof mimes / sizeof *mimes;
+
+    unsigned mime(const char* s)
+    {
+	unsigned n = 0;
+	while (n < nmimes && std::strcmp(mimes[n], s)) n++;
+	return n;
+    }
+
+    /**
+     * Parse the 'user.anydim' value 's', 'n' octets long, into 'res'
+     * if it's for 'key'.
+     */
+    bool parse(const char* s, ssize_t n, const Cache::Key& key,
+	       anydim::Result& res)
+    {
+	char buf[100];
+	if (n <= 0 || size_t(n) >= sizeof buf) return false;
+	std::memcpy(buf, s, n);
+	buf[n] = '\0';
+
+	char type[40];
+	unsigned width;
+	unsigned height;
+	unsigned long long size;
+	long long mtime;
+	char exif[8];
+	if (std::sscanf(buf, "%39s %u %u %llu %lld %7s",
+			type, &width, &height, &size, &mtime, exif)!=6) return false;
+	if (size!=key.size || mtime!=key.mtime) return false;
+	if (std::strcmp(exif, key.exif ? "exif" : "noexif")) return false;
+
+	const unsigned m = mime(type);
+	if (m==nmimes) return false;
+	res.bad = false;
+	res.mime = mimes[m];
+	res.width = width;
+	res.height = height;
+	return true;
+    }
+
+    uint64_t mix(uint64_t h)
+    {
+	h ^= h >> 30; h *= 0xbf58476d1ce4e5b9;
+	h ^= h >> 27; h *= 0x94d049bb133111eb;
+	h ^= h >> 31;
+	return h;
+    }
+
+    uint64_t hash(const Cache::Key& key)
+    {
+	uint64_t h = mix(key.dev);
+	h = mix(h ^ key.ino);
+	h = mix(h ^ key.size);
+	h = mix(h ^ uint64_t(key.mtime));
+	h = mix(h ^ key.exif);
+	return h > busy ? h : h + 2;
+    }
+
+    bool same(const Cache::Entry& e, const Cache::Key& key)
+    {
+	return e.dev==key.dev && e.ino==key.ino &&
+	    e.size==key.size && e.mtime==key.mtime && e.exif==1 + key.exif;
+    }
+
+    uint32_t today()
+    {
+	return std::time(nullptr) / (24 * 3600);
+    }
+
+    int64_t now()
+    {
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    size_t length(uint64_t capacity)
+    {
+	return sizeof(Cache::Header) + capacity * sizeof(Cache::Entry);
+    }
+
+    std::system_error failure(const std::string& path, int err = errno)
+    {
+	return std::system_error {err, std::generic_category(), path};
+    }
+
+    /**
+     * Make the open, empty file 'fd' an empty cache with room for
+     * 'capacity' entries.  The table is a sparse file; the disk
+     * space is allocated as it fills up.
+     */
+    bool init(int fd, uint64_t capacity)
+    {
+	Cache::Header h {};
+	std::memcpy(h.magic, magic, sizeof h.magic);
+	h.capacity = capacity;
+	return ftruncate(fd, length(capacity))==0 &&
+	    pwrite(fd, &h, sizeof h, 0)==sizeof h;
+    }
+
+    /**
+     * Place a copy of 'e' in 'table', without bothering with atomics.
+     * For building a new table nobody else sees yet.
+     */
+    bool place(Cache::Entry* table, uint64_t capacity, const Cache::Entry& e)
+    {
+	const uint64_t mask = capacity - 1;
+	for (unsigned n=0; n < probes; n++) {
+	    Cache::Entry& f = table[(e.tag + n) & mask];
+	    if (f.tag) continue;
+	    f = e;
+	    return true;
+	}
+	return false;
+    }
+}
+
+
+Cache::Key::Key(const struct stat& st, bool exif)
+    : dev {uint64_t(st.st_dev)},
+      ino {uint64_t(st.st_ino)},
+      size {uint64_t(st.st_size)},
+      mtime {st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec},
+      exif {exif}
+{}
+
+/**
+ * Open the cache in 'path', creating it if it doesn't exist.  Creating
+ * it is the only thing which takes a lock, so that two processes
+ * don't both initialize it.
+ */
+Cache::Cache(const std::string& path)
+    : fd {open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666)}
+{
+    if (fd==-1) throw failure(path);
+
+    struct stat st;
+    Header h {};
+    flock(fd, LOCK_EX);
+    bool ok = fstat(fd, &st)==0 && (st.st_size || init(fd, initial));
+    flock(fd, LOCK_UN);
+    if (!ok || fstat(fd, &st)) {
+	const int err = errno;
+	close(fd);
+	throw failure(path, err);
+    }
+
+    const bool got = pread(fd, &h, sizeof h, 0)==sizeof h;
+    const uint64_t cap = h.capacity;
+    if (!got || std::memcmp(h.magic, magic, sizeof magic) ||
+	!cap || cap & (cap - 1) || uint64_t(st.st_size) < length(cap)) {
+	close(fd);
+	throw failure(path, EINVAL);
+    }
+
+    len = length(cap);
+    void* const m = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m==MAP_FAILED) {
+	const int err = errno;
+	close(fd);
+	throw failure(path, err);
+    }
+    header = static_cast<Header*>(m);
+    table = reinterpret_cast<Entry*>(header + 1);
+}
+
+Cache::~Cache()
+{
+    munmap(header, len);
+    close(fd);
+}
+
+/**
+ * Look up 'key', and if it's there, fill in 'res' and return true.
+ */
+bool Cache::find(const Key& key, Result& res)
+{
+    const uint64_t tag = hash(key);
+    const uint64_t mask = header->capacity - 1;
+
+    for (unsigned n=0; n < probes; n++) {
+	Entry& e = table[(tag + n) & mask];
+	const uint64_t t = __atomic_load_n(&e.tag, __ATOMIC_ACQUIRE);
+	if (!t) break;
+	if (t!=tag || !same(e, key) || e.mime >= nmimes) continue;
+
+	res.bad = e.bad;
+	res.mime = mimes[e.mime];
+	res.width = e.width;
+	res.height = e.height;
+
+	const uint32_t day = today();
+	if (__atomic_load_n(&e.used, __ATOMIC_RELAXED)!=day) {
+	    __atomic_store_n(&e.used, day, __ATOMIC_RELAXED);
+	}
+	hits++;
+	return true;
+    }
+    misses++;
+    return false;
+}
+
+/**
+ * Remember 'res' for 'key', unless it's not worth remembering or
+ * the cache is full.
+ */
+void Cache::insert(const Key& key, const Result& res)
+{
+    const unsigned m = mime(res.mime);
+    if (res.error || res.limited || m==nmimes) return;
+    if (key.mtime > now() - settle) return;
+
+    const uint64_t cap = header->capacity;
+    if (__atomic_load_n(&header->count, __ATOMIC_RELAXED) >= cap / 4 * 3) return;
+
+    const uint64_t tag = hash(key);
+    for (unsigned n=0; n < probes; n++) {
+	Entry& e = table[(tag + n) & (cap - 1)];
+	uint64_t t = __atomic_load_n(&e.tag, __ATOMIC_ACQUIRE);
+	if (t==tag && same(e, key)) return;
+	if (t) continue;
+	if (!__atomic_compare_exchange_n(&e.tag, &t, busy, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	    continue;
+	}
+
+	e.dev = key.dev;
+	e.ino = key.ino;
+	e.size = key.size;
+	e.mtime = key.mtime;
+	e.exif = 1 + key.exif;
+	e.width = res.width;
+	e.height = res.height;
+	e.used = today();
+	e.mime = m;
+	e.bad = res.bad;
+	__atomic_store_n(&e.tag, tag, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&header->count, 1, __ATOMIC_RELAXED);
+	inserted++;
+	return;
+    }
+}
+
+void Cache::put(std::ostream& os) const
+{
+    os << "cache hits:    " << hits << '\n'
+       << "cache misses:  " << misses << '\n'
+       << "cache inserts: " << inserted << '\n'
+       << "cache entries: " << __atomic_load_n(&header->count, __ATOMIC_RELAXED)
+       << " of " << header->capacity << '\n';
+}
+
+/**
+ * Rewrite the cache in 'path' without the entries which haven't been
+ * used for more than 'days' days, in a table twice as large as what's
+ * left (but no smaller than a fresh one).  Returns the number of
+ * entries kept.
+ */
+unsigned long Cache::compact(const std::string& path, unsigned days)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st)) throw failure(path);
+    Cache old {path};
+
+    const uint32_t day = today();
+    std::vector<const Entry*> keep;
+    for (uint64_t i=0; i < old.header->capacity; i++) {
+	const Entry& e = old.table[i];
+	if (__atomic_load_n(&e.tag, __ATOMIC_ACQUIRE) <= busy) continue;
+	const int64_t age = day - int64_t(__atomic_load_n(&e.used, __ATOMIC_RELAXED));
+	if (age > days) continue;
+	keep.push_back(&e);
+    }
+
+    uint64_t cap = initial;
+    while (cap < 2 * keep.size()) cap *= 2;
+
+    std::string tmp = path + ".XXXXXX";
+    const int fd = mkstemp(&tmp[0]);
+    if (fd==-1) throw failure(tmp);
+    void* m = MAP_FAILED;
+    if (fchmod(fd, st.st_mode & 0777)==0 && init(fd, cap)) {
+	m = mmap(nullptr, length(cap), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (m==MAP_FAILED) {
+	const int err = errno;
+	close(fd);
+	unlink(tmp.c_str());
+	throw failure(tmp, err);
+    }
+
+    const auto header = static_cast<Header*>(m);
+    const auto table = reinterpret_cast<Entry*>(header + 1);
+    for (const Entry* e : keep) {
+	if (place(table, cap, *e)) header->count++;
+    }
+    const unsigned long kept = header->count;
+    munmap(m, length(cap));
+
+    if (fsync(fd) || rename(tmp.c_str(), path.c_str())) {
+	const int err = errno;
+	close(fd);
+	unlink(tmp.c_str());
+	throw failure(path, err);
+    }
+    close(fd);
+    return kept;
+}
+
+
+namespace {
+    const char xattr[] = "user.anydim";
+}
+
+bool anydim::get_xattr(const char* path, const Cache::Key& key, Result& res)
+{
+    char buf[100];
+    return parse(buf, getxattr(path, xattr, buf, sizeof buf), key, res);
+}
+
+bool anydim::get_xattr(int fd, const Cache::Key& key, Result& res)
+{
+    char buf[100];
+    return parse(buf, fgetxattr(fd, xattr, buf, sizeof buf), key, res);
+}
+
+void anydim::set_xattr(int fd, const Cache::Key& key, const Result& res)
+{
+    if (res.error || res.bad || mime(res.mime)==nmimes) return;
+    if (key.mtime > now() - settle) return;
+
+    char buf[100];
+    const int n = std::snprintf(buf, sizeof buf, "%s %u %u %llu %lld %s",
+				res.mime, res.width, res.height,
+				static_cast<unsigned long long>(key.size),
+				static_cast<long long>(key.mtime),
+				key.exif ? "exif" : "noexif");
+    fsetxattr(fd, xattr, buf, n, 0);
+}
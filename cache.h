@@ -0,0 +1,119 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_CACHE_H
+#define ANYDIM_CACHE_H
+
+#include "anydim.h"
+
+#include <iosfwd>
+#include <string>
+#include <atomic>
+
+struct stat;
+
+namespace anydim {
+
+    /**
+     * A persistent cache of results, in a file which is mapped into
+     * memory and may be shared by many processes at once.
+     *
+     * A file is known by its device, inode, size and modification
+     * time; if any of them changes, it's a different file as far as
+     * the cache is concerned.  The key also says whether EXIF
+     * orientation was used, since that gives different dimensions
+     * for the same file.  The results cached are the dimensions and
+     * MIME type of images, and the fact that a file is bad; I/O errors
+     * are not cached, and neither are files which were bad only
+     * because of a limit.  Nor are files modified in the last few
+     * seconds, which may still change without changing the key.
+     *
+     * The file is an open-addressing hash table with linear probing.
+     * Lookups and inserts take no locks: an entry is claimed with a
+     * compare-and-swap on its tag, filled in, and published by
+     * setting the tag to the key's hash.  Published entries never
+     * change, except for the day they were last used, so a reader
+     * which sees the tag can trust the rest.  Two processes inserting
+     * the same key at once may leave two identical entries, which is
+     * harmless.
+     *
+     * Entries for files which have since changed or disappeared just
+     * sit there.  The table doesn't grow either; when it's three
+     * quarters full, nothing more is inserted.  compact() rewrites it
+     * without the entries unused for a number of days, and with room
+     * to grow, and renames the result over the old file.  Processes
+     * still using the old file are unaffected, but what they insert
+     * is lost.
+     *
+     * The constructor and compact() throw std::system_error.
+     */
+    class Cache {
+    public:
+	explicit Cache(const std::string& path);
+	~Cache();
+	Cache(const Cache&) = delete;
+	Cache& operator= (const Cache&) = delete;
+
+	struct Key {
+	    Key(const struct stat& st, bool exif);
+	    Key(uint64_t dev, uint64_t ino, uint64_t size, int64_t mtime,
+		bool exif = true)
+		: dev {dev}, ino {ino}, size {size}, mtime {mtime}, exif {exif}
+	    {}
+
+	    uint64_t dev;
+	    uint64_t ino;
+	    uint64_t size;
+	    int64_t mtime;
+	    bool exif;
+	};
+
+	bool find(const Key& key, Result& res);
+	void insert(const Key& key, const Result& res);
+
+	void put(std::ostream& os) const;
+
+	static unsigned long compact(const std::string& path, unsigned days);
+
+	struct Header;
+	struct Entry;
+
+    private:
+	int fd;
+	size_t len;
+	Header* header;
+	Entry* table;
+
+	std::atomic<unsigned long> hits {0};
+	std::atomic<unsigned long> misses {0};
+	std::atomic<unsigned long> inserted {0};
+    };
+
+    /**
+     * The result for a file, cached in its own 'user.anydim' extended
+     * attribute, so that it follows the file when it's copied with
+     * its attributes (e.g. rsync -aX).  The value is text, like
+     *
+     *   image/png 48 21 1536 1612345678123456789 exif
+     *
+     * that is, the MIME type, width, height, the size and
+     * modification time (in nanoseconds) the file had when it was
+     * probed, and "exif" or "noexif" for whether EXIF orientation was
+     * used.  get_xattr() ignores values where these don't match the
+     * 'key' (only the size, mtime and exif matter), so a file which
+     * has changed since is probed again, and a --no-exif run doesn't
+     * get rotated dimensions.  Only good results are stored,
+     * and not for files modified in the last few seconds.
+     *
+     * set_xattr() needs the right to write to the file, but not an
+     * open file descriptor for writing; failures are ignored.
+     */
+    bool get_xattr(const char* path, const Cache::Key& key, Result& res);
+    bool get_xattr(int fd, const Cache::Key& key, Result& res);
+    void set_xattr(int fd, const Cache::Key& key, const Result& res);
+}
+
+#endif
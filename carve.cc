@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "carve.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using anydim::Result;
+
+
+namespace {
+
+    bool ws(uint8_t ch)
+    {
+	return ch==' ' || ch=='\t' || ch=='\r' || ch=='\n';
+    }
+
+    /**
+     * True if there may be an image at 'p'; there are at least three
+     * octets there.
+     */
+    bool candidate(const uint8_t* p)
+    {
+	switch (p[0]) {
+	case 0xff: return p[1]==0xd8 && p[2]==0xff;
+	case 0x89: return p[1]=='P' && p[2]=='N';
+	case 'P': return p[1]>='1' && p[1]<='6' && ws(p[2]);
+	default: return false;
+	}
+    }
+
+#ifdef __SSE2__
+    /**
+     * The candidates among the 16 positions starting at 'p', as a
+     * bit mask.  There are at least 18 octets there.
+     */
+    unsigned candidates(const uint8_t* p)
+    {
+	auto load = [] (const uint8_t* p) {
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		    };
+	auto eq = [] (__m128i v, uint8_t c) {
+		      return _mm_cmpeq_epi8(v, _mm_set1_epi8(char(c)));
+		  };
+	const __m128i v0 = load(p);
+	const __m128i v1 = load(p + 1);
+	const __m128i v2 = load(p + 2);
+
+	const __m128i jpeg = _mm_and_si128(_mm_and_si128(eq(v0, 0xff), eq(v1, 0xd8)),
+					   eq(v2, 0xff));
+	const __m128i png = _mm_and_si128(_mm_and_si128(eq(v0, 0x89), eq(v1, 'P')),
+					  eq(v2, 'N'));
+	/* '1' <= v1 <= '6', that is, v1 - '1' is at most 5 unsigned */
+	const __m128i d = _mm_sub_epi8(v1, _mm_set1_epi8('1'));
+	const __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(5)), d);
+	const __m128i space = _mm_or_si128(_mm_or_si128(eq(v2, ' '), eq(v2, '\n')),
+					   _mm_or_si128(eq(v2, '\r'), eq(v2, '\t')));
+	const __m128i pnm = _mm_and_si128(_mm_and_si128(eq(v0, 'P'), digit), space);
+
+	const __m128i any = _mm_or_si128(_mm_or_si128(jpeg, png), pnm);
+	return _mm_movemask_epi8(any);
+    }
+#endif
+
+    /**
+     * The first candidate in [p, end), or 'end'.  The data goes on
+     * to 'limit', at least two octets past 'end'.
+     */
+    const uint8_t* next(const uint8_t* p, const uint8_t* end,
+			const uint8_t* limit)
+    {
+#ifdef __SSE2__
+	while (end - p >= 16 && limit - p >= 18) {
+	    const unsigned mask = candidates(p);
+	    if (mask) return p + __builtin_ctz(mask);
+	    p += 16;
+	}
+#else
+	(void)limit;
+#endif
+	while (p!=end && !candidate(p)) p++;
+	return p;
+    }
+
+    /**
+     * A closer look at candidate 'p': the JPEG SOI must be followed
+     * by a real marker, like APP0 or DQT, since the JPEG decoder is
+     * forgiving enough to find things in random data.
+     */
+    bool plausible(const uint8_t* p, const uint8_t* limit)
+    {
+	if (p[0]!=0xff) return true;
+	return limit - p > 3 && p[3] >= 0xc0 && p[3]!=0xff;
+    }
+
+    /**
+     * Decode speculatively from 'p', with at most 'n' octets there.
+     */
+    Result decode(const uint8_t* p, size_t n, const anydim::Options& options)
+    {
+	const uint64_t limit = options.max_octets ? options.max_octets : 1 << 20;
+	anydim::AnyDim dim {options.use_exif, limit};
+	size_t pos = 0;
+	while (dim.undecided() && pos < n) {
+	    const size_t m = std::min(n - pos, size_t(4096));
+	    dim.feed(p + pos, p + pos + m);
+	    pos += m;
+	    if (dim.undecided()) {
+		const size_t skip = std::min(dim.skippable(), n - pos);
+		dim.skip(skip);
+		pos += skip;
+	    }
+	}
+	if (dim.undecided()) dim.eof();
+	return Result {dim};
+    }
+}
+
+
+void anydim::carve(const uint8_t* data, size_t size,
+		   size_t begin, size_t end,
+		   const Options& options, const Found& found)
+{
+    /* a candidate needs three octets */
+    end = std::min(end, size >= 2 ? size - 2 : 0);
+    if (begin >= end) return;
+
+    const uint8_t* const limit = data + size;
+    const uint8_t* p = data + begin;
+    while (true) {
+	p = next(p, data + end, limit);
+	if (p==data + end) break;
+
+	if (plausible(p, limit)) {
+	    const Result res = decode(p, limit - p, options);
+	    if (!res.bad) found(p - data, res);
+	}
+	p++;
+    }
+}
@@ -0,0 +1,38 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_CARVE_H
+#define ANYDIM_CARVE_H
+
+#include "anydim.h"
+
+#include <functional>
+
+namespace anydim {
+
+    /**
+     * What to do with an image found at 'offset'.
+     */
+    using Found = std::function<void(uint64_t offset, const Result& res)>;
+
+    /**
+     * Carving: find images which start anywhere in [begin, end) of
+     * 'data' (which is 'size' octets, like a whole disk image), and
+     * pass the good ones to 'found', in order.
+     *
+     * Candidates are a JPEG SOI followed by a marker (FF D8 FF), the
+     * start of the PNG signature (89 'P' 'N'), and "P1" to "P6"
+     * followed by whitespace; they're searched for 16 octets at a time
+     * with SSE2, where there is SSE2.  At each candidate, a fresh
+     * AnyDim gets the data from there on, until it's decided, or has
+     * seen the Options' max_octets (by default 1 MiB).
+     */
+    void carve(const uint8_t* data, size_t size,
+	       size_t begin, size_t end,
+	       const Options& options, const Found& found);
+}
+
+#endif
@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "anydim.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+
+#include <zlib.h>
+#include <lzma.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using anydim::CompressedDim;
+
+
+/**
+ * A streaming decompressor.  run() decompresses from [a, b) into
+ * [out, out+n), advances 'a' past what it used, and returns the
+ * number of octets written there, or -1 if the data is corrupt.
+ * With 'finish', there's no more input, and it flushes what's left.
+ * reset() makes it ready for another stream, keeping its memory.
+ */
+class CompressedDim::Codec {
+public:
+    virtual ~Codec() = default;
+    virtual long run(const uint8_t*& a, const uint8_t* b,
+		     uint8_t* out, size_t n, bool finish) = 0;
+    virtual void reset() = 0;
+};
+
+
+namespace {
+
+    class Gzip final: public CompressedDim::Codec {
+    public:
+	Gzip()
+	{
+	    std::memset(&z, 0, sizeof z);
+	    ok = inflateInit2(&z, 16 + MAX_WBITS)==Z_OK;
+	}
+	~Gzip() { if(ok) inflateEnd(&z); }
+
+	void reset() override
+	{
+	    if(ok) ok = inflateReset(&z)==Z_OK;
+	    end = false;
+	}
+
+	long run(const uint8_t*& a, const uint8_t* b,
+		 uint8_t* out, size_t n, bool finish) override
+	{
+	    if(!ok) return -1;
+	    if(end) {
+		a = b;
+		return 0;
+	    }
+	    z.next_in = const_cast<uint8_t*>(a);
+	    z.avail_in = b - a;
+	    z.next_out = out;
+	    z.avail_out = n;
+	    const int rc = inflate(&z, finish? Z_FINISH: Z_NO_FLUSH);
+	    a = b - z.avail_in;
+	    if(rc==Z_STREAM_END) end = true;
+	    else if(rc!=Z_OK && rc!=Z_BUF_ERROR) return -1;
+	    return n - z.avail_out;
+	}
+
+    private:
+	z_stream z;
+	bool ok;
+	bool end = false;
+    };
+
+    class Xz final: public CompressedDim::Codec {
+    public:
+	Xz()
+	    : allocator {alloc, release, this},
+	      s LZMA_STREAM_INIT
+	{
+	    s.allocator = &allocator;
+	    reset();
+	}
+	~Xz()
+	{
+	    lzma_end(&s);
+	    while(spare) {
+		Header* const h = spare;
+		spare = h->next;
+		std::free(h);
+	    }
+	}
+
+	/* Enough for xz -9, with its 64 MiB dictionary.  A tiny file
+	 * can declare a dictionary of gigabytes; then lzma_code()
+	 * says LZMA_MEMLIMIT_ERROR rather than allocate it, and the
+	 * image is bad.
+	 */
+	static constexpr uint64_t memlimit = 80 << 20;
+
+	/* initializing a used stream reuses its memory */
+	void reset() override
+	{
+	    ok = lzma_stream_decoder(&s, memlimit, 0)==LZMA_OK;
+	    end = false;
+	}
+
+	long run(const uint8_t*& a, const uint8_t* b,
+		 uint8_t* out, size_t n, bool finish) override
+	{
+	    if(!ok) return -1;
+	    if(end) {
+		a = b;
+		return 0;
+	    }
+	    s.next_in = a;
+	    s.avail_in = b - a;
+	    s.next_out = out;
+	    s.avail_out = n;
+	    const lzma_ret rc = lzma_code(&s, finish? LZMA_FINISH: LZMA_RUN);
+	    a = b - s.avail_in;
+	    if(rc==LZMA_STREAM_END) end = true;
+	    else if(rc!=LZMA_OK && rc!=LZMA_BUF_ERROR) return -1;
+	    return n - s.avail_out;
+	}
+
+    private:
+	/**
+	 * liblzma frees and allocates a few small things at each block
+	 * header, so small blocks are kept on a list when freed, and
+	 * handed out again to allocations of the same size.
+	 */
+	struct alignas(std::max_align_t) Header {
+	    Header* next;
+	    size_t size;
+	};
+	static constexpr size_t small = 4096;
+
+	static void* alloc(void* opaque, size_t nmemb, size_t size)
+	{
+	    if(size && nmemb > SIZE_MAX/size) return nullptr;
+	    const size_t n = nmemb * size;
+	    Header*& spare = static_cast<Xz*>(opaque)->spare;
+	    for(Header** p = &spare; *p; p = &(*p)->next) {
+		Header* const h = *p;
+		if(h->size!=n) continue;
+		*p = h->next;
+		return h + 1;
+	    }
+	    if(n > SIZE_MAX - sizeof (Header)) return nullptr;
+	    Header* const h = static_cast<Header*>(std::malloc(sizeof (Header) + n));
+	    if(!h) return nullptr;
+	    h->size = n;
+	    return h + 1;
+	}
+
+	static void release(void* opaque, void* p)
+	{
+	    if(!p) return;
+	    Header* const h = static_cast<Header*>(p) - 1;
+	    if(h->size > small) {
+		std::free(h);
+		return;
+	    }
+	    Header*& spare = static_cast<Xz*>(opaque)->spare;
+	    h->next = spare;
+	    spare = h;
+	}
+
+	lzma_allocator allocator;
+	Header* spare = nullptr;
+	lzma_stream s;
+	bool ok;
+	bool end = false;
+    };
+
+#ifdef HAVE_ZSTD
+    class Zstd final: public CompressedDim::Codec {
+    public:
+	Zstd() : s {ZSTD_createDStream()} {}
+	~Zstd() { ZSTD_freeDStream(s); }
+
+	void reset() override
+	{
+	    if(s) ZSTD_DCtx_reset(s, ZSTD_reset_session_only);
+	}
+
+	long run(const uint8_t*& a, const uint8_t* b,
+		 uint8_t* out, size_t n, bool finish) override
+	{
+	    (void)finish;
+	    if(!s) return -1;
+	    ZSTD_inBuffer in {a, size_t(b - a), 0};
+	    ZSTD_outBuffer ob {out, n, 0};
+	    const size_t rc = ZSTD_decompressStream(s, &ob, &in);
+	    if(ZSTD_isError(rc)) return -1;
+	    a += in.pos;
+	    return ob.pos;
+	}
+
+    private:
+	ZSTD_DStream* const s;
+    };
+#endif
+
+    struct Magic {
+	std::vector<uint8_t> octets;
+	CompressedDim::Codec* (*codec)();
+    };
+
+    template <class C>
+    CompressedDim::Codec* make() { return new C; }
+
+    const Magic magics[] = {
+	{{0x1f, 0x8b}, make<Gzip>},
+	{{0xfd, '7', 'z', 'X', 'Z', 0x00}, make<Xz>},
+#ifdef HAVE_ZSTD
+	{{0x28, 0xb5, 0x2f, 0xfd}, make<Zstd>},
+#endif
+    };
+    const size_t nmagics = sizeof magics / sizeof *magics;
+
+    bool prefix(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+    {
+	const size_t n = std::min(a.size(), b.size());
+	return std::equal(a.begin(), a.begin() + n, b.begin());
+    }
+}
+
+
+CompressedDim::CompressedDim(bool use_exif, uint64_t limit, unsigned nesting)
+    : use_exif_(use_exif),
+      limit_(limit),
+      nesting_(nesting),
+      codecs_(nmagics),
+      codec_(0),
+      dim_(0),
+      skip_(0)
+{}
+
+CompressedDim::~CompressedDim()
+{
+    delete dim_;
+    for(Codec* codec : codecs_) delete codec;
+}
+
+
+const char* CompressedDim::mime() const
+{
+    return dim_? dim_->mime(): "image";
+}
+
+
+void CompressedDim::feed(const uint8_t *a, const uint8_t *b)
+{
+    if(state_!=UNDECIDED) return;
+
+    if(!codec_) {
+	while(a!=b && !codec_ && state_==UNDECIDED) {
+	    magic_.push_back(*a++);
+	    start();
+	}
+	if(!codec_) return;
+	/* with a codec, this doesn't touch magic_ */
+	feed(magic_.data(), magic_.data() + magic_.size());
+	magic_.clear();
+	if(a==b) return;
+    }
+
+    uint8_t buf[4096];
+    long n;
+    do {
+	n = codec_->run(a, b, buf, sizeof buf, false);
+	if(n==-1) {
+	    state_ = BAD;
+	    return;
+	}
+	pass(buf, buf + n);
+    } while(state_==UNDECIDED && (a!=b || n==sizeof buf));
+}
+
+
+void CompressedDim::eof()
+{
+    if(state_!=UNDECIDED) return;
+    if(!codec_) {
+	state_ = BAD;
+	return;
+    }
+
+    uint8_t buf[4096];
+    const uint8_t* const end = buf;
+    long n;
+    do {
+	const uint8_t* a = end;
+	n = codec_->run(a, end, buf, sizeof buf, true);
+	if(n > 0) pass(buf, buf + n);
+    } while(state_==UNDECIDED && n==sizeof buf);
+
+    if(state_==UNDECIDED) {
+	dim_->eof();
+	decide();
+    }
+}
+
+
+/**
+ * Forget which Codec we use, since that's specific to the format,
+ * but keep them all, and our AnyDim, for the next file.
+ */
+void CompressedDim::reset()
+{
+    Dim::reset();
+    magic_.clear();
+    codec_ = 0;
+    if(dim_) dim_->reset();
+    skip_ = 0;
+}
+
+
+/**
+ * Pick the Codec, if the magic octets seen so far are enough to tell,
+ * or decide it's not compressed at all.
+ */
+void CompressedDim::start()
+{
+    bool maybe = false;
+    for(size_t i=0; i<nmagics; i++) {
+	const Magic& m = magics[i];
+	if(!prefix(magic_, m.octets)) continue;
+	if(magic_.size() < m.octets.size()) {
+	    maybe = true;
+	    continue;
+	}
+	Codec*& codec = codecs_[i];
+	if(codec) codec->reset();
+	else codec = m.codec();
+	codec_ = codec;
+	if(!dim_) dim_ = new AnyDim(use_exif_, limit_, nullptr, nesting_);
+	return;
+    }
+    if(!maybe) state_ = BAD;
+}
+
+
+/**
+ * Feed decompressed [a, b) to the AnyDim, except what it says it
+ * can skip.
+ */
+void CompressedDim::pass(const uint8_t *a, const uint8_t *b)
+{
+    while(a!=b && dim_->undecided()) {
+	const size_t n = std::min(skip_, size_t(b - a));
+	if(n) {
+	    dim_->skip(n);
+	    skip_ -= n;
+	    a += n;
+	    continue;
+	}
+	dim_->feed(a, b);
+	a = b;
+	if(dim_->undecided()) skip_ = dim_->skippable();
+    }
+    decide();
+}
+
+void CompressedDim::decide()
+{
+    if(dim_->undecided()) return;
+    if(dim_->bad()) {
+	state_ = BAD;
+	return;
+    }
+    state_ = GOOD;
+    width = dim_->width;
+    height = dim_->height;
+}
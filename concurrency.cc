@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "concurrency.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+
+namespace {
+
+    /* Latency below both 2 × the lowest seen and the lowest + 1 ms
+     * counts as unsaturated.  The lowest creeps up slowly, so that a
+     * few lucky early probes don't count forever.
+     */
+    const double slack = 1e-3;
+    const double creep = 1e-3;
+
+    std::string dirname(const std::string& file)
+    {
+	const auto n = file.rfind('/');
+	if (n==std::string::npos) return ".";
+	if (n==0) return "/";
+	return file.substr(0, n);
+    }
+}
+
+
+Concurrency::Concurrency(unsigned max)
+    : max {max ? max : 1}
+{}
+
+/**
+ * The device of 'file', which is assumed to be that of its directory.
+ * That way, we stat(2) each directory once rather than each file.
+ */
+dev_t Concurrency::device(const std::string& file)
+{
+    const std::string dir = dirname(file);
+    {
+	std::lock_guard<std::mutex> lock {mutex};
+	auto it = dirs.find(dir);
+	if (it!=end(dirs)) return it->second;
+    }
+
+    struct stat st;
+    const dev_t dev = stat(dir.c_str(), &st)==0 ? st.st_dev : 0;
+
+    std::lock_guard<std::mutex> lock {mutex};
+    dirs.emplace(dir, dev);
+    return dev;
+}
+
+bool Concurrency::admit(dev_t dev)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    Device& d = devices[dev];
+    if (d.active >= unsigned(d.limit)) return false;
+    d.active++;
+    return true;
+}
+
+void Concurrency::acquire(dev_t dev)
+{
+    std::unique_lock<std::mutex> lock {mutex};
+    Device& d = devices[dev];
+    room.wait(lock, [&d] { return d.active < unsigned(d.limit); });
+    d.active++;
+}
+
+void Concurrency::release(dev_t dev, double seconds, bool ok)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    Device& d = devices[dev];
+    d.active--;
+    d.done++;
+
+    if (!d.base || seconds < d.base) d.base = seconds;
+    else d.base += (seconds - d.base) * creep;
+    d.latency = d.latency ? 0.9 * d.latency + 0.1 * seconds : seconds;
+
+    const bool saturated = d.latency > std::max(2 * d.base, d.base + slack);
+    if (ok && !saturated) {
+	d.limit = std::min(d.limit + 1 / d.limit, double(max));
+    }
+    else if (d.done - d.decreased > d.limit) {
+	d.limit = std::max(d.limit / 2, 1.0);
+	d.decreased = d.done;
+    }
+    room.notify_all();
+}
+
+/**
+ * Print the current limit of each device.
+ */
+void Concurrency::put(std::ostream& os) const
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    for (const auto& val : devices) {
+	const dev_t dev = val.first;
+	os << "concurrency:   " << major(dev) << ':' << minor(dev) << ' '
+	   << std::fixed << std::setprecision(1) << val.second.limit << '\n';
+    }
+}
+
+
+Concurrency::Permit::Permit(Concurrency& concurrency, dev_t dev)
+    : concurrency {&concurrency},
+      dev {dev},
+      t0 {clock::now()}
+{}
+
+Concurrency::Permit::~Permit()
+{
+    done(false);
+}
+
+/**
+ * The probe is done.  It's not 'ok' if it failed in a way which may be
+ * the file system's way of saying it's overloaded, like a timeout.
+ */
+void Concurrency::Permit::done(bool ok)
+{
+    if (!concurrency) return;
+    const std::chrono::duration<double> dt = clock::now() - t0;
+    concurrency->release(dev, dt.count(), ok);
+    concurrency = nullptr;
+}
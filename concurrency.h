@@ -0,0 +1,92 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_CONCURRENCY_H
+#define ANYDIM_CONCURRENCY_H
+
+#include <iosfwd>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include <sys/types.h>
+
+/**
+ * How many files to probe at once, found out while probing: a limit
+ * for each file system (st_dev), adjusted AIMD-style.
+ *
+ * A probe may start when its file's device has fewer probes in
+ * progress than its limit allows; admit() says if that's so, and if
+ * it is, counts the probe as started.  (acquire() waits for it
+ * instead.)  The probe then holds a Permit for the device.  When the
+ * probe is done, its latency is compared to the lowest
+ * latency seen on the device.  As long as it stays close to that,
+ * more concurrency means more throughput, and the limit grows by one
+ * per round of probes.  When it doesn't, the device is saturated (or
+ * a probe failed), and the limit is halved, at most once per round.
+ *
+ * The limits are between 1 and 'max'; the caller should have that
+ * many threads to take permits.
+ */
+class Concurrency {
+public:
+    explicit Concurrency(unsigned max);
+    Concurrency(const Concurrency&) = delete;
+    Concurrency& operator= (const Concurrency&) = delete;
+
+    class Permit;
+
+    dev_t device(const std::string& file);
+    bool admit(dev_t dev);
+    void acquire(dev_t dev);
+
+    void put(std::ostream& os) const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Device {
+	double limit = 4;
+	unsigned active = 0;
+	double base = 0;
+	double latency = 0;
+	unsigned long done = 0;
+	unsigned long decreased = 0;
+    };
+
+    const unsigned max;
+
+    mutable std::mutex mutex;
+    std::condition_variable room;
+    std::map<dev_t, Device> devices;
+    std::unordered_map<std::string, dev_t> dirs;
+
+    void release(dev_t dev, double seconds, bool ok);
+};
+
+/**
+ * The right to probe a file on device 'dev', already admitted or
+ * acquired, from construction until done().
+ */
+class Concurrency::Permit {
+public:
+    Permit(Concurrency& concurrency, dev_t dev);
+    ~Permit();
+    Permit(const Permit&) = delete;
+    Permit& operator= (const Permit&) = delete;
+
+    void done(bool ok);
+
+private:
+    Concurrency* concurrency;
+    const dev_t dev;
+    clock::time_point t0;
+};
+
+#endif
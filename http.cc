@@ -0,0 +1,557 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "http.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using anydim::Http;
+using anydim::Result;
+
+
+namespace {
+
+    const uint64_t unknown = std::numeric_limits<uint64_t>::max();
+
+    bool prefix(const std::string& s, const char* p)
+    {
+	return s.compare(0, std::strlen(p), p)==0;
+    }
+
+    std::string lower(std::string s)
+    {
+	for (char& ch : s) ch = std::tolower(static_cast<unsigned char>(ch));
+	return s;
+    }
+
+    bool space(char ch)
+    {
+	const unsigned char c = ch;
+	return c <= ' ' || c==0x7f;
+    }
+
+    /**
+     * The path with control characters and spaces percent-encoded, so
+     * that a name with (say) CR LF in it can't add lines to a request.
+     */
+    std::string escape(const std::string& path)
+    {
+	std::string s;
+	for (char ch : path) {
+	    if (space(ch)) {
+		const char hex[] = "0123456789ABCDEF";
+		const unsigned char c = ch;
+		s += '%';
+		s += hex[c >> 4];
+		s += hex[c & 15];
+	    }
+	    else {
+		s += ch;
+	    }
+	}
+	return s;
+    }
+
+    /**
+     * Split "http://host[:port][/path]", where the host may be an IPv6
+     * address in brackets.  The path comes back escaped, ready for a
+     * request line; spaces or control characters in the host or port
+     * make it fail.
+     */
+    bool split(const std::string& url,
+	       std::string& host, std::string& port, std::string& path)
+    {
+	if (!prefix(lower(url.substr(0, 7)), "http://")) return false;
+	std::string::size_type a = 7;
+	std::string::size_type b;
+	if (url.size() > a && url[a]=='[') {
+	    b = url.find(']', a);
+	    if (b==std::string::npos) return false;
+	    host = url.substr(a + 1, b - a - 1);
+	    b++;
+	}
+	else {
+	    b = std::min(url.find_first_of(":/", a), url.size());
+	    host = url.substr(a, b - a);
+	}
+	if (host.empty()) return false;
+
+	port = "80";
+	if (b < url.size() && url[b]==':') {
+	    const auto c = std::min(url.find('/', b), url.size());
+	    port = url.substr(b + 1, c - b - 1);
+	    b = c;
+	}
+	path = b < url.size() ? escape(url.substr(b)) : "/";
+	return !port.empty() && std::none_of(url.begin(), url.begin() + b, space);
+    }
+
+    /**
+     * A socket with a bit of buffering, for reading a response head
+     * line by line and then the body.
+     */
+    class Conn {
+    public:
+	explicit Conn(int fd) : fd {fd} {}
+
+	bool send(const std::string& s);
+	int line(std::string& s);
+	ssize_t read(uint8_t* a, size_t n);
+
+	int fd;
+
+    private:
+	std::vector<uint8_t> buf;
+	size_t pos = 0;
+
+	ssize_t recv(uint8_t* a, size_t n);
+    };
+
+    bool Conn::send(const std::string& s)
+    {
+	const char* p = s.data();
+	size_t n = s.size();
+	while (n) {
+	    const ssize_t rc = ::send(fd, p, n, MSG_NOSIGNAL);
+	    if (rc==-1 && errno==EINTR) continue;
+	    if (rc==-1) {
+		if (errno==EAGAIN) errno = ETIMEDOUT;
+		return false;
+	    }
+	    p += rc;
+	    n -= rc;
+	}
+	return true;
+    }
+
+    ssize_t Conn::recv(uint8_t* a, size_t n)
+    {
+	while (true) {
+	    const ssize_t rc = ::recv(fd, a, n, 0);
+	    if (rc==-1 && errno==EINTR) continue;
+	    if (rc==-1 && errno==EAGAIN) errno = ETIMEDOUT;
+	    return rc;
+	}
+    }
+
+    /**
+     * Read a line, without its CRLF, into 's'.  Returns 0, an errno,
+     * or EPROTO if the connection closes first (or the line is
+     * absurdly long).
+     */
+    int Conn::line(std::string& s)
+    {
+	s.clear();
+	while (true) {
+	    if (pos==buf.size()) {
+		buf.resize(4096);
+		pos = 0;
+		const ssize_t rc = recv(buf.data(), buf.size());
+		if (rc <= 0) {
+		    buf.clear();
+		    return rc ? errno : EPROTO;
+		}
+		buf.resize(rc);
+	    }
+	    const auto a = buf.begin() + pos;
+	    const auto nl = std::find(a, buf.end(), '\n');
+	    s.append(a, nl);
+	    pos = nl - buf.begin();
+	    if (nl!=buf.end()) {
+		pos++;
+		if (!s.empty() && s.back()=='\r') s.pop_back();
+		return 0;
+	    }
+	    if (s.size() > 8192) return EPROTO;
+	}
+    }
+
+    /**
+     * Like read(2), but taking what's buffered first.
+     */
+    ssize_t Conn::read(uint8_t* a, size_t n)
+    {
+	if (pos < buf.size()) {
+	    n = std::min(n, buf.size() - pos);
+	    std::copy(buf.begin() + pos, buf.begin() + pos + n, a);
+	    pos += n;
+	    return n;
+	}
+	return recv(a, n);
+    }
+
+    /**
+     * The interesting parts of a response head.
+     */
+    struct Response {
+	int status = 0;
+	bool keepalive = false;
+	bool chunked = false;
+	uint64_t length = unknown;
+	uint64_t first = 0;
+	uint64_t total = unknown;
+    };
+
+    int head(Conn& c, Response& r)
+    {
+	std::string s;
+	if (const int err = c.line(s)) return err;
+	if (!prefix(s, "HTTP/1.") || s.size() < 12) return EPROTO;
+	r.keepalive = s[7]=='1';
+	r.status = std::atoi(s.c_str() + 9);
+
+	while (true) {
+	    if (const int err = c.line(s)) return err;
+	    if (s.empty()) break;
+	    const auto colon = s.find(':');
+	    if (colon==std::string::npos) continue;
+	    const std::string name = lower(s.substr(0, colon));
+	    std::string val = s.substr(colon + 1);
+	    val.erase(0, val.find_first_not_of(" \t"));
+
+	    if (name=="content-length") {
+		r.length = std::strtoull(val.c_str(), nullptr, 10);
+	    }
+	    else if (name=="transfer-encoding") {
+		r.chunked = lower(val).find("chunked")!=std::string::npos;
+	    }
+	    else if (name=="connection") {
+		const std::string v = lower(val);
+		if (v.find("close")!=std::string::npos) r.keepalive = false;
+		if (v.find("keep-alive")!=std::string::npos) r.keepalive = true;
+	    }
+	    else if (name=="content-range") {
+		/* bytes first-last/total */
+		const char* p = val.c_str();
+		if (std::strncmp(p, "bytes ", 6)) return EPROTO;
+		char* end;
+		r.first = std::strtoull(p + 6, &end, 10);
+		const char* slash = std::strchr(end, '/');
+		if (slash && slash[1]!='*') {
+		    r.total = std::strtoull(slash + 1, nullptr, 10);
+		}
+	    }
+	}
+	if (r.chunked) r.length = unknown;
+	return 0;
+    }
+
+    /**
+     * The body of a response: Content-Length octets, chunked, or (if
+     * neither) everything until the server closes the connection.
+     */
+    class Body {
+    public:
+	Body(Conn& c, const Response& r)
+	    : c {c},
+	      chunked {r.chunked},
+	      left {r.length}
+	{
+	    if (!chunked && !left) done = true;
+	}
+
+	ssize_t read(uint8_t* a, size_t n);
+	int drain();
+
+	bool done = false;
+
+    private:
+	Conn& c;
+	const bool chunked;
+	uint64_t left;
+	bool first = true;
+    };
+
+    /**
+     * Read up to 'n' octets of the body; 0 once it's done.  A body
+     * which ends too soon is EPROTO.
+     */
+    ssize_t Body::read(uint8_t* a, size_t n)
+    {
+	if (done) return 0;
+
+	if (chunked && !left) {
+	    std::string s;
+	    if (!first) {
+		if (const int err = c.line(s)) return errno = err, -1;
+	    }
+	    first = false;
+	    if (const int err = c.line(s)) return errno = err, -1;
+	    left = std::strtoull(s.c_str(), nullptr, 16);
+	    if (!left) {
+		/* the trailer */
+		do {
+		    if (const int err = c.line(s)) return errno = err, -1;
+		} while (!s.empty());
+		done = true;
+		return 0;
+	    }
+	}
+
+	const ssize_t rc = c.read(a, std::min(uint64_t(n), left));
+	if (rc==-1) return -1;
+	if (rc==0) {
+	    done = true;
+	    if (left==unknown) return 0;
+	    errno = EPROTO;
+	    return -1;
+	}
+	if (left!=unknown) left -= rc;
+	if (!chunked && !left) done = true;
+	return rc;
+    }
+
+    /**
+     * Read the rest of the body, so that the connection can be
+     * reused.
+     */
+    int Body::drain()
+    {
+	uint8_t buf[4096];
+	while (!done) {
+	    if (read(buf, sizeof buf)==-1) return errno;
+	}
+	return 0;
+    }
+
+    Result failure(Result res, int err)
+    {
+	res.error = err;
+	return res;
+    }
+
+    int status_error(int status)
+    {
+	switch (status) {
+	case 404:
+	case 410:
+	    return ENOENT;
+	case 401:
+	case 403:
+	    return EACCES;
+	default:
+	    return EPROTO;
+	}
+    }
+}
+
+
+Http::~Http()
+{
+    for (const auto& val : idle) {
+	for (int fd : val.second) close(fd);
+    }
+}
+
+bool Http::url(const std::string& s)
+{
+    const std::string p = lower(s.substr(0, 8));
+    return prefix(p, "http://") || prefix(p, "https://");
+}
+
+/**
+ * A connection to host:port, an idle one if we have it (unless
+ * 'fresh'), or a new one.
+ */
+int Http::connect(const std::string& host, const std::string& port,
+		  bool fresh, unsigned timeout, bool& reused)
+{
+    const std::string key = host + ' ' + port;
+    int fd = -1;
+    if (!fresh) {
+	std::lock_guard<std::mutex> lock {mutex};
+	auto& v = idle[key];
+	if (!v.empty()) {
+	    fd = v.back();
+	    v.pop_back();
+	}
+    }
+    reused = fd!=-1;
+
+    if (fd==-1) {
+	addrinfo hints {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* ai;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &ai)) {
+	    errno = EHOSTUNREACH;
+	    return -1;
+	}
+	int err = EHOSTUNREACH;
+	for (addrinfo* p = ai; p && fd==-1; p = p->ai_next) {
+	    fd = socket(p->ai_family, p->ai_socktype | SOCK_CLOEXEC, p->ai_protocol);
+	    if (fd==-1) {
+		err = errno;
+		continue;
+	    }
+	    const timeval tv {timeout / 1000, long(timeout % 1000) * 1000};
+	    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+	    if (::connect(fd, p->ai_addr, p->ai_addrlen)) {
+		err = errno==EINPROGRESS ? ETIMEDOUT : errno;
+		close(fd);
+		fd = -1;
+	    }
+	}
+	freeaddrinfo(ai);
+	if (fd==-1) {
+	    errno = err;
+	    return -1;
+	}
+	const int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    }
+
+    const timeval tv {timeout / 1000, long(timeout % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+    return fd;
+}
+
+void Http::release(const std::string& host, const std::string& port, int fd)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    idle[host + ' ' + port].push_back(fd);
+}
+
+Result Http::probe(const std::string& url, const Options& options)
+{
+    Result res;
+    std::string host, port, path;
+    if (!split(url, host, port, path)) return failure(res, EPROTONOSUPPORT);
+    const std::string hostport = port=="80" ? host : host + ':' + port;
+
+    AnyDim dim {options.use_exif, options.max_octets, options.memo};
+    uint64_t offset = 0;
+    uint64_t size = unknown;
+    size_t len = 4096;
+    uint8_t buf[4096];
+
+    while (dim.undecided()) {
+	if (offset >= size) {
+	    dim.eof();
+	    break;
+	}
+	const size_t want = dim.want();
+	const uint64_t n = std::min(uint64_t(want ? std::min(want, len) : len),
+				    size - offset);
+
+	const std::string req = "GET " + path + " HTTP/1.1\r\n"
+	    "Host: " + hostport + "\r\n"
+	    "Range: bytes=" + std::to_string(offset) + '-'
+	    + std::to_string(offset + n - 1) + "\r\n"
+	    "User-Agent: anydim\r\n"
+	    "\r\n";
+
+	/* a reused connection may have been closed by the server */
+	Conn c {-1};
+	Response r;
+	int err = 0;
+	for (bool fresh : {false, true}) {
+	    bool reused;
+	    c = Conn {connect(host, port, fresh, options.timeout, reused)};
+	    if (c.fd==-1) return failure(res, errno);
+	    err = c.send(req) ? head(c, r) : errno;
+	    if (!err || !reused) break;
+	    close(c.fd);
+	}
+	if (err) {
+	    close(c.fd);
+	    return failure(res, err);
+	}
+
+	Body body {c, r};
+	auto done = [&] {
+			if (r.keepalive && body.drain()==0) release(host, port, c.fd);
+			else close(c.fd);
+		    };
+
+	if (r.status==416) {
+	    done();
+	    dim.eof();
+	    break;
+	}
+	if (r.status!=200 && r.status!=206) {
+	    done();
+	    return failure(res, status_error(r.status));
+	}
+	if (r.status==206 && r.first!=offset) {
+	    close(c.fd);
+	    return failure(res, EPROTO);
+	}
+
+	/* With 200, it's the whole file, of which we've maybe seen the
+	 * first 'offset' octets.  With 206, it's the range we asked
+	 * for, but we need to read all of it anyway.
+	 */
+	uint64_t pos = r.status==200 ? 0 : offset;
+	uint64_t skip = offset - pos;
+	while (true) {
+	    if (options.budget) options.budget->read(sizeof buf);
+	    const ssize_t m = body.read(buf, sizeof buf);
+	    if (options.budget && m < ssize_t(sizeof buf)) {
+		options.budget->unread(sizeof buf - std::max(m, ssize_t(0)));
+	    }
+	    if (m==-1) {
+		err = errno;
+		close(c.fd);
+		return failure(res, err);
+	    }
+	    if (m==0) break;
+	    uint8_t* a = buf;
+	    uint8_t* const b = buf + m;
+	    while (a!=b && dim.undecided()) {
+		const uint64_t k = std::min(skip, uint64_t(b - a));
+		if (k) {
+		    a += k;
+		    skip -= k;
+		    pos += k;
+		    continue;
+		}
+		res.tally(pos, b - a);
+		dim.feed(a, b);
+		pos += b - a;
+		a = b;
+		if (dim.undecided()) {
+		    skip = dim.skippable();
+		    dim.skip(skip);
+		}
+	    }
+	    if (r.status==200 && !dim.undecided()) break;
+	}
+
+	if (r.status==200) {
+	    if (body.done) {
+		done();
+		if (dim.undecided()) dim.eof();
+	    }
+	    else {
+		close(c.fd);
+	    }
+	    break;
+	}
+
+	done();
+	if (r.total!=unknown) size = r.total;
+	offset = pos + skip;
+	len = std::min(len * 4, size_t(1) << 20);
+    }
+
+    res.decided(dim);
+    return res;
+}
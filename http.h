@@ -0,0 +1,59 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_HTTP_H
+#define ANYDIM_HTTP_H
+
+#include "anydim.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+namespace anydim {
+
+    /**
+     * Probing images over HTTP (not HTTPS), with range requests.
+     *
+     * The first request is for the first 4 KiB (or less, if the
+     * decoders want() less), and further requests are made only while
+     * the AnyDim is undecided, for exponentially larger ranges, and
+     * past whatever it can skip.  A server which ignores the Range
+     * header and sends the whole file works too, but then we read
+     * only what we need and drop the connection.
+     *
+     * Connections are kept alive, and reused for later probes of the
+     * same host and port; probe() may be called from many threads at
+     * once.
+     *
+     * Errors are errno values like for probe(): ENOENT for 404,
+     * EACCES for 401 and 403, EPROTO for other failures and
+     * unexpected responses, and EPROTONOSUPPORT for other URLs than
+     * http:// ones.
+     */
+    class Http {
+    public:
+	Http() = default;
+	~Http();
+	Http(const Http&) = delete;
+	Http& operator= (const Http&) = delete;
+
+	Result probe(const std::string& url, const Options& options);
+
+	static bool url(const std::string& s);
+
+    private:
+	std::mutex mutex;
+	std::map<std::string, std::vector<int>> idle;
+
+	int connect(const std::string& host, const std::string& port,
+		    bool fresh, unsigned timeout, bool& reused);
+	void release(const std::string& host, const std::string& port, int fd);
+    };
+}
+
+#endif
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019 Jrgen Grahn
+ * Copyright (c) 2019 Jörgen Grahn
  * All rights reserved.
  *
  */
@@ -32,6 +32,10 @@ namespace jfif {
     /**
      * Helper for growing segments incrementally and pushing them
      * onto a vector of found segments.
+     *
+     * The segments of earlier files are kept as 'spare' and reused,
+     * buffers and all, so once a decoder has seen a few files it
+     * rarely allocates anything.
      */
     struct Accumulator {
 	explicit Accumulator(std::vector<Segment>& dst) : dst(dst) {}
@@ -43,17 +47,42 @@ namespace jfif {
 	void msb(unsigned n);
 	void lsb(unsigned n);
 	const uint8_t* feed(const uint8_t *a, const uint8_t *b);
+	void skip(size_t n);
+	void push(unsigned ch, const std::vector<uint8_t>& data);
+	void recycle();
 
 	uint8_t marker;
 	unsigned missing = 0;
 	std::vector<uint8_t> v;
 	std::vector<Segment>& dst;
+	std::vector<Segment> spare;
     };
 
+    // Push a segment onto 'dst', reusing a spare one if we have it.
+    void Accumulator::push(unsigned ch, const std::vector<uint8_t>& data)
+    {
+	if (spare.empty()) {
+	    dst.emplace_back(ch, data);
+	    return;
+	}
+	dst.push_back(std::move(spare.back()));
+	spare.pop_back();
+	dst.back().marker = ch;
+	dst.back().v.assign(data.begin(), data.end());
+    }
+
+    // Take back the segments in 'dst' as spares, and empty it.
+    void Accumulator::recycle()
+    {
+	std::move(dst.begin(), dst.end(), std::back_inserter(spare));
+	dst.clear();
+    }
+
     // Emit a standalone segment.
     void Accumulator::emit(unsigned ch)
     {
-	dst.emplace_back(ch, std::vector<uint8_t>{});
+	static const std::vector<uint8_t> none;
+	push(ch, none);
     }
 
     // Begin a normal segment with marker 'ch'.
@@ -89,10 +118,19 @@ namespace jfif {
 	append(v, a, c);
 	missing -= c - a;
 	if (!missing) {
-	    dst.emplace_back(marker, v);
+	    push(marker, v);
 	}
 	return c;
     }
+
+    // Like feed(), but for n octets we don't want to see.
+    void Accumulator::skip(size_t n)
+    {
+	missing -= n;
+	if (!missing) {
+	    push(marker, v);
+	}
+    }
 }
 
 Decoder::Decoder()
@@ -193,3 +231,47 @@ std::vector<Segment>& Decoder::end()
 
     return v;
 }
+
+/**
+ * Start over, for another file.
+ */
+void Decoder::reset()
+{
+    acc->recycle();
+    acc->missing = 0;
+    acc->v.clear();
+    state = State::Start;
+}
+
+/**
+ * The marker of the segment we're in the middle of, or 0 if we're not
+ * inside a segment's data.
+ */
+unsigned Decoder::marker() const
+{
+    if (state!=State::Segment) return 0;
+    return acc->marker;
+}
+
+/**
+ * How many of the coming octets are data of the current segment (if
+ * any), and may be skip()ped rather than fed, if you're not
+ * interested in that segment.
+ */
+size_t Decoder::skippable() const
+{
+    if (state!=State::Segment) return 0;
+    return acc->missing;
+}
+
+/**
+ * Skip 'n' octets of the current segment's data, where n is at most
+ * skippable().  The segment will still appear in the result, but
+ * with its data truncated.
+ */
+void Decoder::skip(size_t n)
+{
+    if (!n) return;
+    acc->skip(std::min(n, skippable()));
+    if (!acc->missing) state = State::Entropy;
+}
@@ -1,6 +1,6 @@
 /* -*- c++ -*-
  *
- * Copyright (c) 2019 Jrgen Grahn
+ * Copyright (c) 2019 Jörgen Grahn
  * All rights reserved.
  *
  * The JFIF file format, as I understand it:
@@ -115,6 +115,12 @@ namespace jfif {
 	void feed(const uint8_t *a, const uint8_t *b);
 	std::vector<Segment>& end();
 
+	unsigned marker() const;
+	size_t skippable() const;
+	void skip(size_t n);
+
+	void reset();
+
 	std::vector<Segment> v;
 
 	enum class State {
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "layout.h"
+
+#include <iostream>
+#include <algorithm>
+#include <tuple>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+
+
+void List::push(const std::string& file)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    files.push_back(file);
+}
+
+
+namespace {
+
+    /**
+     * Where a file is: its device, and the physical position of its
+     * first extent or, if there is none (an empty file, data stored in
+     * the inode, or a file system which won't tell), its inode number.
+     * The two aren't comparable, so the latter come after the former.
+     */
+    struct Key {
+	bool missing = true;
+	dev_t dev = 0;
+	bool inode = false;
+	uint64_t pos = 0;
+
+	bool operator< (const Key& other) const
+	{
+	    return std::tie(missing, dev, inode, pos)
+		< std::tie(other.missing, other.dev, other.inode, other.pos);
+	}
+    };
+
+    /**
+     * The physical position of the first extent of open file 'fd',
+     * or 0 if the file system won't tell, or there are no extents.
+     */
+    uint64_t first_extent(int fd)
+    {
+	alignas(fiemap) char buf[sizeof(fiemap) + sizeof(fiemap_extent)] {};
+	auto map = reinterpret_cast<fiemap*>(buf);
+	map->fm_start = 0;
+	map->fm_length = FIEMAP_MAX_OFFSET;
+	map->fm_extent_count = 1;
+
+	if (ioctl(fd, FS_IOC_FIEMAP, map)) return 0;
+	if (!map->fm_mapped_extents) return 0;
+	return map->fm_extents[0].fe_physical;
+    }
+
+    Key key_of(const std::string& file, int flags)
+    {
+	Key key;
+	int fd = open(file.c_str(), flags | O_RDONLY | O_CLOEXEC);
+	if (fd==-1 && (flags & O_NOATIME) && errno==EPERM) {
+	    /* O_NOATIME is only for the file's owner (or root) */
+	    fd = open(file.c_str(), (flags & ~O_NOATIME) | O_RDONLY | O_CLOEXEC);
+	}
+	if (fd==-1) return key;
+
+	struct stat st;
+	if (fstat(fd, &st)==0) {
+	    key.missing = false;
+	    key.dev = st.st_dev;
+	    key.pos = first_extent(fd);
+	    if (!key.pos) {
+		key.inode = true;
+		key.pos = st.st_ino;
+	    }
+	}
+	close(fd);
+	return key;
+    }
+}
+
+
+std::vector<size_t> physical_order(const std::vector<std::string>& files,
+				   int flags, Throttle* throttle)
+{
+    std::vector<Key> keys;
+    keys.reserve(files.size());
+    for (const auto& file : files) {
+	if (throttle) throttle->open();
+	keys.push_back(key_of(file, flags));
+    }
+
+    std::vector<size_t> v(files.size());
+    for (size_t i=0; i<v.size(); i++) v[i] = i;
+    std::stable_sort(begin(v), end(v),
+		     [&keys] (size_t a, size_t b) { return keys[a] < keys[b]; });
+    return v;
+}
+
+
+Reorder::Reorder(const std::vector<std::string>& files)
+    : results(files.size())
+{
+    for (size_t i=0; i<files.size(); i++) {
+	index[files[i]].push_back(i);
+    }
+}
+
+/**
+ * Accept the result for 'file'.  If the same name appears more than
+ * once, the results fill its places in order.
+ */
+void Reorder::put(const std::string& file, const std::string& result)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    auto& q = index[file];
+    if (q.empty()) return;
+    results[q.front()] = result;
+    q.pop_front();
+}
+
+void Reorder::write(std::ostream& os) const
+{
+    for (const auto& s : results) os << s;
+}
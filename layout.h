@@ -0,0 +1,68 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_LAYOUT_H
+#define ANYDIM_LAYOUT_H
+
+#include "batch.h"
+#include "throttle.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+
+/**
+ * A Batch which just collects the file names, so they can be probed
+ * later, in some other order.
+ */
+class List final : public Batch {
+public:
+    void push(const std::string& file) override;
+    bool join() override { return true; }
+
+    std::vector<std::string> files;
+
+private:
+    std::mutex mutex;
+};
+
+/**
+ * The order in which to read 'files' (as indices into it) so that
+ * the disk heads sweep in one direction: by device, and then by the
+ * physical location of the file's first extent according to
+ * FS_IOC_FIEMAP.  Files without one (or on a file system which
+ * doesn't support that) follow, by inode number.  Files which can't
+ * be opened come last.
+ *
+ * The files are opened with 'flags' (like O_NOATIME) in addition to
+ * O_RDONLY; without O_NOATIME if that's not permitted.  If there's a
+ * 'throttle', the opens are taken from it.
+ */
+std::vector<size_t> physical_order(const std::vector<std::string>& files,
+				   int flags = 0,
+				   Throttle* throttle = nullptr);
+
+/**
+ * The results for 'files', which arrive in any order, but are written
+ * in the original order.
+ */
+class Reorder {
+public:
+    explicit Reorder(const std::vector<std::string>& files);
+
+    void put(const std::string& file, const std::string& result);
+    void write(std::ostream& os) const;
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, std::deque<size_t>> index;
+    std::vector<std::string> results;
+};
+
+#endif
@@ -1,67 +1,430 @@
 /* $Id: main.cc,v 1.8 2011-01-08 12:25:43 grahn Exp $
  *
- * Copyright (c) 2011, 2021 Jrgen Grahn
+ * Copyright (c) 2011, 2021 Jörgen Grahn
  * All rights reserved.
  *
  */
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <system_error>
+#include <limits>
 
 #include <cstdlib>
 #include <cstring>
+#include <cctype>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <getopt.h>
+#include <sys/stat.h>
 
 #include "anydim.h"
+#include "archive.h"
+#include "http.h"
+#include "serve.h"
+#include "carve.h"
+#include "pool.h"
+#include "uring.h"
+#include "walk.h"
+#include "watch.h"
+#include "layout.h"
+#include "alarm.h"
+#include "throttle.h"
+#include "concurrency.h"
+#include "cache.h"
+#include "memo.h"
 
 
 namespace {
 
-    bool dimensions(std::ostream& os,
-		    const char* const file,
-		    bool do_mime,
-		    bool do_filename,
-		    bool do_exif,
-		    bool do_landscape)
+    /**
+     * How to print the dimensions of a file.
+     */
+    struct Format {
+	bool mime;
+	bool filename;
+	bool landscape;
+    };
+
+    /**
+     * Statistics for --stats, collected from all threads.
+     */
+    struct Stats {
+	std::atomic<unsigned long> files {0};
+	std::atomic<unsigned long> failed {0};
+	std::atomic<uint64_t> octets {0};
+	std::atomic<uint64_t> pages {0};
+
+	void add(const anydim::Result& res);
+	void put(std::ostream& os) const;
+    };
+
+    void Stats::add(const anydim::Result& res)
     {
-	if(do_filename && file) {
+	files++;
+	if(res.error || res.bad) failed++;
+	octets += res.octets;
+	pages += res.pages;
+    }
+
+    void Stats::put(std::ostream& os) const
+    {
+	os << "files:         " << files << '\n'
+	   << "failed:        " << failed << '\n'
+	   << "octets read:   " << octets << '\n'
+	   << "pages touched: " << pages << '\n';
+    }
+
+    Stats stats;
+
+    /**
+     * The number of threads reading directories for -r with -j auto.
+     * The probing may use up to 64, but the walk only has to stay
+     * ahead of it, and more readers than this rarely help a single
+     * tree; they'd mostly compete with the probes for the storage.
+     */
+    const unsigned auto_walkers = 8;
+
+    /**
+     * Print the outcome of probing 'file'.  Returns false if it was a
+     * failure, for whatever reason.
+     */
+    bool report(std::ostream& os,
+		const char* const file,
+		const anydim::Result& res,
+		const Format& fmt)
+    {
+	stats.add(res);
+
+	if(fmt.filename && file) {
 	    os << file << ' ';
 	}
 
-	std::ifstream inf;
-	if(file) inf.open(file);
-	std::istream& in = file? inf: std::cin;
-
-	anydim::AnyDim dim {do_exif};
-	char buf[4096];
-	while(in && dim.undecided()) {
-	    in.read(buf, sizeof buf);
-	    const uint8_t* ubuf = reinterpret_cast<const uint8_t*>(buf);
-	    dim.feed(ubuf, ubuf + in.gcount());
+	if(res.error==ETIMEDOUT) {
+	    os << "ERROR: timeout\n";
+	    return false;
 	}
-	if(!in) dim.eof();
 
-	if(in.bad()) {
-	    os << "ERROR: " << std::strerror(errno) << '\n';
+	if(res.error) {
+	    os << "ERROR: " << std::strerror(res.error) << '\n';
 	    return false;
 	}
 
-	if(dim.bad()) {
-	    os << "ERROR: not a valid " << dim.mime() << " file\n";
+	if(res.bad) {
+	    os << "ERROR: not a valid " << res.mime << " file\n";
 	    return false;
 	}
 
-	if(do_mime) {
-	    os << dim.mime() << ' ';
+	if(fmt.mime) {
+	    os << res.mime << ' ';
 	}
 
-	auto a = dim.width;
-	auto b = dim.height;
-	if(a < b && do_landscape) std::swap(a, b);
+	auto a = res.width;
+	auto b = res.height;
+	if(a < b && fmt.landscape) std::swap(a, b);
 
 	os << a << ' ' << b << '\n';
 	return true;
     }
+
+    /**
+     * Run the probe 'f' with the Options::timeout, on a Runner of
+     * the calling thread's own, so that a probe which is stuck for
+     * good is given up on, rather than the thread with it.
+     */
+    anydim::Result timed(const anydim::Options& options,
+			 const std::function<anydim::Result()>& f)
+    {
+	thread_local Runner runner;
+	anydim::Result res;
+	if(!runner.run(options.timeout, f, res)) res.error = ETIMEDOUT;
+	return res;
+    }
+
+    bool dimensions(std::ostream& os,
+		    const char* const file,
+		    const anydim::Options& options,
+		    const Format& fmt)
+    {
+	const anydim::Result res = timed(options, [file, options] {
+						 return file
+						     ? anydim::probe(file, options)
+						     : anydim::probe(0, options);
+					     });
+	return report(os, file, res, fmt);
+    }
+
+    /**
+     * Print the dimensions of the members of the tar or (if 'zip')
+     * ZIP archive 'file', or standard input.
+     */
+    bool archive(std::ostream& os,
+		 const char* const file,
+		 const bool zip,
+		 const anydim::Options& options,
+		 const Format& fmt)
+    {
+	const int fd = file? open(file, O_RDONLY | O_CLOEXEC): 0;
+	if(fd==-1) {
+	    std::cerr << file << ": " << std::strerror(errno) << '\n';
+	    return false;
+	}
+
+	bool ok = true;
+	auto member = [&] (const std::string& name, const anydim::Result& res) {
+			  if(!report(os, name.c_str(), res, fmt)) ok = false;
+		      };
+	const int err = zip
+	    ? anydim::probe_zip(fd, options, member)
+	    : anydim::probe_tar(fd, options, member);
+	if(file) close(fd);
+
+	if(err) {
+	    std::cerr << (file? file: "stdin") << ": ";
+	    if(err==EINVAL) {
+		std::cerr << "not a valid " << (zip? "ZIP": "tar") << " archive\n";
+	    }
+	    else {
+		std::cerr << std::strerror(err) << '\n';
+	    }
+	    return false;
+	}
+	return ok;
+    }
+
+    /**
+     * Read up to 'n' octets at 'offset' into 'buf', stopping at the
+     * end of file or the first error.  Returns the number of octets
+     * read, and sets 'err' to the errno if there was an error.
+     */
+    size_t pread_all(int fd, uint8_t* buf, size_t n, off_t offset, int& err)
+    {
+	size_t len = 0;
+	err = 0;
+	while(len < n) {
+	    const ssize_t rc = pread(fd, buf + len, n - len, offset + len);
+	    if(rc==-1 && errno==EINTR) continue;
+	    if(rc==-1) err = errno;
+	    if(rc <= 0) break;
+	    len += rc;
+	}
+	return len;
+    }
+
+    /**
+     * Print the offset and dimensions of the images found anywhere in
+     * 'file', prefixed by its name if 'name'.  The file is split into
+     * blocks, which are carved by a Pool with 'jobs' workers.
+     *
+     * Each block is read with pread(2), together with enough of the
+     * next one for an image starting near its end, so a bad sector
+     * (not unusual in a disk image) is an EIO for the block it's in,
+     * rather than a SIGBUS for the whole run.
+     */
+    bool carve(std::ostream& os,
+	       const char* const file,
+	       const bool name,
+	       const anydim::Options& options,
+	       const Format& fmt,
+	       const unsigned jobs)
+    {
+	const int fd = open(file, O_RDONLY | O_CLOEXEC);
+	struct stat st;
+	off_t size = -1;
+	if(fd!=-1 && fstat(fd, &st)==0) {
+	    /* a directory may "seek" to LLONG_MAX */
+	    if(S_ISDIR(st.st_mode)) errno = EISDIR;
+	    else size = lseek(fd, 0, SEEK_END);
+	}
+	if(fd==-1 || size==-1) {
+	    std::cerr << file << ": " << std::strerror(errno) << '\n';
+	    if(fd!=-1) close(fd);
+	    return false;
+	}
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	const size_t block = 64 << 20;
+	const size_t overlap = std::min(size_t(options.max_octets
+					       ? options.max_octets
+					       : 1 << 20),
+					block);
+
+	auto task = [=] (std::ostream& os, const std::string& s) {
+			const off_t begin = std::stoull(s);
+			const size_t end = std::min(off_t(block), size - begin);
+			thread_local std::unique_ptr<uint8_t[]> buf;
+			if(!buf) buf.reset(new uint8_t[block + overlap]);
+
+			int err;
+			const size_t len = pread_all(fd, buf.get(), end + overlap,
+						     begin, err);
+			auto found = [&] (uint64_t offset, const anydim::Result& res) {
+					 std::string s = std::to_string(begin + offset);
+					 if(name) s = file + (' ' + s);
+					 report(os, s.c_str(), res, fmt);
+				     };
+			anydim::carve(buf.get(), len, 0, std::min(len, end),
+				      options, found);
+			if(options.gentle) {
+			    posix_fadvise(fd, begin, end, POSIX_FADV_DONTNEED);
+			}
+			if(err && len < end) {
+			    std::cerr << file << ": at " << begin + len << ": "
+				      << std::strerror(err) << '\n';
+			    return false;
+			}
+			return true;
+		    };
+	Pool pool {os, task, jobs, true};
+	for(off_t begin=0; begin < size; begin += block) {
+	    pool.push(std::to_string(begin));
+	}
+	const bool ok = pool.join();
+
+	close(fd);
+	return ok;
+    }
+
+    /**
+     * Probe 'file', which may also be an http:// URL.
+     */
+    anydim::Result probe(const std::string& file,
+			 const anydim::Options& options)
+    {
+	static anydim::Http http;
+	if(anydim::Http::url(file)) return http.probe(file, options);
+	return anydim::probe(file.c_str(), options);
+    }
+
+    /**
+     * The Batch to probe files with: io_uring with 'depth', if that's
+     * nonzero and io_uring works (and then 'jobs' is ignored, with a
+     * warning), or a Pool with 'jobs' workers.
+     * The results go to 'os' or, if there is one, 'reorder'.  The
+     * files opened are taken from the 'throttle' budget, if there is
+     * one, by the workers right before they probe (or, for the ring,
+     * as they're pushed); the octets are taken by the probes, as the
+     * Options' budget.  With 'concurrency' the workers take turns
+     * according to it.
+     */
+    std::unique_ptr<Batch> batch(std::ostream& os, Reorder* reorder,
+				 Throttle* throttle,
+				 Concurrency* concurrency,
+				 const anydim::Options& options,
+				 const Format& fmt,
+				 unsigned jobs, unsigned depth, bool ordered)
+    {
+	auto put = [=] (std::ostream& os, const std::string& file,
+			const anydim::Result& res) {
+		       if(!reorder) return report(os, file.c_str(), res, fmt);
+		       std::ostringstream ss;
+		       const bool ok = report(ss, file.c_str(), res, fmt);
+		       reorder->put(file, ss.str());
+		       return ok;
+		   };
+
+	if(depth) {
+	    try {
+		std::unique_ptr<Batch> uring {
+		    new Uring {os, put, options, depth, ordered}};
+		if(jobs > 1) {
+		    std::cerr << "warning: -j doesn't apply to probing with --uring\n";
+		}
+		if(throttle) uring.reset(new Throttled {std::move(uring),
+							*throttle});
+		return uring;
+	    }
+	    catch (const Uring::Unavailable&) {}
+	}
+
+	auto task = [=] (std::ostream& os, const std::string& file) {
+			auto f = [file, options] { return probe(file, options); };
+			if(throttle) throttle->open();
+			if(!concurrency) {
+			    return put(os, file, timed(options, f));
+			}
+			Concurrency::Permit permit {*concurrency,
+						    concurrency->device(file)};
+			const auto res = timed(options, f);
+			permit.done(res.error!=ETIMEDOUT && res.error!=EIO);
+			return put(os, file, res);
+		    };
+	return std::unique_ptr<Batch> {
+	    new Pool {os, task, jobs, ordered, concurrency}};
+    }
+
+    /**
+     * Push the file names in 'is' onto the batch, one at a time. The
+     * names are terminated by 'delim', and empty names are ignored.
+     * Since the batch blocks when it's full, this works for
+     * arbitrarily long lists.
+     */
+    bool push_all(Batch& batch, std::istream& is, char delim)
+    {
+	std::string file;
+	while(std::getline(is, file, delim)) {
+	    if(file.empty()) continue;
+	    batch.push(file);
+	}
+	return !is.bad();
+    }
+
+    /**
+     * Be a co-process: answer requests "id file" on 'is', one per
+     * line, with "id width height" (or whatever 'fmt' says) on 'os',
+     * flushed as soon as it's ready.  The id is anything without a
+     * space, so the caller can match answers to requests; with 'jobs'
+     * several requests are probed at once, and answered in the order
+     * they finish.
+     */
+    bool coprocess(std::istream& is, std::ostream& os,
+		   const anydim::Options& options, const Format& fmt,
+		   unsigned jobs)
+    {
+	auto task = [&] (std::ostream& os, const std::string& line) {
+			const auto sp = line.find(' ');
+			const std::string id = line.substr(0, sp);
+			const std::string file =
+			    sp==std::string::npos? "": line.substr(sp+1);
+			const auto res = timed(options, [file, options] {
+						   return probe(file, options);
+					       });
+			std::ostringstream ss;
+			ss << id << ' ';
+			const bool ok = report(ss, nullptr, res, fmt);
+			os << ss.str();
+			return ok;
+		    };
+
+	os << std::unitbuf;
+	Pool pool {os, task, jobs, false};
+	const bool ok = push_all(pool, is, '\n');
+	return pool.join() && ok;
+    }
+
+    /**
+     * Parse a rate like "10M" (octets per second) into 'rate', with
+     * the usual binary suffixes.  The empty string is zero.
+     */
+    bool parse_rate(const std::string& s, double& rate)
+    {
+	if(s.empty()) {
+	    rate = 0;
+	    return true;
+	}
+	char* end;
+	rate = std::strtod(s.c_str(), &end);
+	switch(*end) {
+	case 'k': rate *= 1024; end++; break;
+	case 'M': rate *= 1024 * 1024; end++; break;
+	case 'G': rate *= 1024 * 1024 * 1024; end++; break;
+	}
+	return end!=s.c_str() && !*end && rate >= 0;
+    }
 }
 
 
@@ -72,11 +435,62 @@ int main(int argc, char ** argv)
     const string prog = argv[0];
     const string usage = string("usage: ")
 	+ prog
-	+ " [-i] [-H|-h] [--no-exif] [--landscape] file ...";
-    const char optstring[] = "iHhLX";
+	+ " [-i] [-H|-h] [--no-exif] [--landscape] [-j N|auto [--unordered]] "
+	"[-r dir [--ext=list] [--name=glob]] [--watch=dir] "
+	"[--files-from=file [-0]] [--uring[=depth]] "
+	"[--gentle] [--stats] [--physical] [--timeout=ms] [--max-bytes=N] "
+	"[--io-rate=octets[,files]] [--cache=file] [--xattr] [--thumbnails] "
+	"[--memo] file ...";
+    const string usage_tar = string("       ")
+	+ prog
+	+ " --tar|--zip [-i] [-h] [--no-exif] [--landscape] [--max-bytes=N] "
+	"[archive ...]";
+    const string usage_carve = string("       ")
+	+ prog
+	+ " --carve [-H|-h] [--no-exif] [--landscape] [--max-bytes=N] "
+	"[-j N] file ...";
+    const string usage_compact = string("       ")
+	+ prog
+	+ " --cache=file --compact-cache[=days] [--stats]";
+    const string usage_serve = string("       ")
+	+ prog
+	+ " --serve=socket [-j N] [--no-exif] [--gentle] [--timeout=ms] "
+	"[--max-bytes=N] [--cache=file] [--xattr] [--memo] [--stats]";
+    const string usage_client = string("       ")
+	+ prog
+	+ " --client=socket [-i] [-H|-h] [--landscape] [file ...]";
+    const string usage_coprocess = string("       ")
+	+ prog
+	+ " --coprocess [-i] [--no-exif] [--landscape] [-j N] [--timeout=ms] "
+	"[--max-bytes=N] [--cache=file] [--xattr] [--memo]";
+    const char optstring[] = "iHhLXj:r:0";
     struct option long_options[] = {
 	{"landscape", 0, 0, 'L'},
 	{"no-exif", 0, 0, 'X'},
+	{"unordered", 0, 0, 'U'},
+	{"ext", 1, 0, 'E'},
+	{"name", 1, 0, 'N'},
+	{"files-from", 1, 0, 'F'},
+	{"null", 0, 0, '0'},
+	{"uring", 2, 0, 'u'},
+	{"gentle", 0, 0, 'G'},
+	{"stats", 0, 0, 'S'},
+	{"physical", 0, 0, 'P'},
+	{"timeout", 1, 0, 'T'},
+	{"max-bytes", 1, 0, 'M'},
+	{"io-rate", 1, 0, 'R'},
+	{"tar", 0, 0, 't'},
+	{"zip", 0, 0, 'z'},
+	{"carve", 0, 0, 'C'},
+	{"cache", 1, 0, 'K'},
+	{"compact-cache", 2, 0, 'k'},
+	{"xattr", 0, 0, 'x'},
+	{"thumbnails", 0, 0, 'n'},
+	{"memo", 0, 0, 'm'},
+	{"serve", 1, 0, 's'},
+	{"client", 1, 0, 'c'},
+	{"coprocess", 0, 0, 'o'},
+	{"watch", 1, 0, 'w'},
 	{"version", 0, 0, 'v'},
 	{"help", 0, 0, '!'},
 	{0, 0, 0, 0}
@@ -85,8 +499,30 @@ int main(int argc, char ** argv)
     int ch;
     bool do_mime = false;
     bool do_landscape = false;
-    bool do_exif = true;
+    anydim::Options options;
+    bool do_stats = false;
+    bool physical = false;
     char hflag = 0;
+    unsigned jobs = 1;
+    bool adaptive = false;
+    bool ordered = true;
+    std::vector<string> roots;
+    std::vector<string> watches;
+    Filter filter;
+    const char* files_from = 0;
+    char delim = '\n';
+    unsigned uring = 0;
+    double octet_rate = 0;
+    double file_rate = 0;
+    char do_archive = 0;
+    bool do_carve = false;
+    const char* cache_file = 0;
+    bool do_compact = false;
+    bool do_memo = false;
+    unsigned days = 30;
+    const char* serve_socket = 0;
+    const char* client_socket = 0;
+    bool do_coprocess = false;
     while((ch = getopt_long(argc, argv,
 			    optstring, &long_options[0], 0)) != -1) {
 	switch(ch) {
@@ -95,21 +531,157 @@ int main(int argc, char ** argv)
 	    break;
 	case 'L':
 	    do_landscape = true;
-	    do_exif = false;
+	    options.use_exif = false;
 	    break;
 	case 'X':
-	    do_exif = false;
+	    options.use_exif = false;
 	    break;
 	case 'H':
 	case 'h':
 	    hflag = ch;
 	    break;
+	case 'j': {
+	    adaptive = string(optarg)=="auto";
+	    if(adaptive) {
+		jobs = 64;
+		break;
+	    }
+	    char* end;
+	    jobs = std::strtoul(optarg, &end, 10);
+	    if(!std::isdigit(*optarg) || *end || !jobs) {
+		std::cerr << usage << '\n';
+		return 1;
+	    }
+	    break;
+	}
+	case 'U':
+	    ordered = false;
+	    break;
+	case 'r':
+	    roots.push_back(optarg);
+	    break;
+	case 'w':
+	    watches.push_back(optarg);
+	    break;
+	case 'E':
+	    filter.ext(optarg);
+	    break;
+	case 'N':
+	    filter.glob(optarg);
+	    break;
+	case 'F':
+	    files_from = optarg;
+	    break;
+	case '0':
+	    delim = '\0';
+	    break;
+	case 'u': {
+	    if(!optarg) {
+		uring = 256;
+		break;
+	    }
+	    char* end;
+	    const unsigned long n = std::strtoul(optarg, &end, 10);
+	    if(!std::isdigit(*optarg) || *end || !n || n > Uring::max_depth) {
+		std::cerr << usage << '\n';
+		return 1;
+	    }
+	    uring = n;
+	    break;
+	}
+	case 'G':
+	    options.gentle = true;
+	    break;
+	case 'S':
+	    do_stats = true;
+	    break;
+	case 'P':
+	    physical = true;
+	    break;
+	case 'T': {
+	    char* end;
+	    const unsigned long n = std::strtoul(optarg, &end, 10);
+	    if(!std::isdigit(*optarg) || *end || !n ||
+	       n > std::numeric_limits<unsigned>::max()) {
+		std::cerr << usage << '\n';
+		return 1;
+	    }
+	    options.timeout = n;
+	    break;
+	}
+	case 'M': {
+	    char* end;
+	    errno = 0;
+	    options.max_octets = std::strtoull(optarg, &end, 10);
+	    if(!std::isdigit(*optarg) || *end || errno==ERANGE ||
+	       !options.max_octets) {
+		std::cerr << usage << '\n';
+		return 1;
+	    }
+	    break;
+	}
+	case 'R': {
+	    const string s = optarg;
+	    const auto comma = s.find(',');
+	    if(!parse_rate(s.substr(0, comma), octet_rate) ||
+	       (comma!=string::npos &&
+		!parse_rate(s.substr(comma+1), file_rate))) {
+		std::cerr << usage << '\n';
+		return 1;
+	    }
+	    break;
+	}
+	case 't':
+	case 'z':
+	    do_archive = ch;
+	    break;
+	case 'C':
+	    do_carve = true;
+	    break;
+	case 'K':
+	    cache_file = optarg;
+	    break;
+	case 'x':
+	    options.xattr = true;
+	    break;
+	case 'n':
+	    options.thumbnails = true;
+	    break;
+	case 'm':
+	    do_memo = true;
+	    break;
+	case 's':
+	    serve_socket = optarg;
+	    break;
+	case 'c':
+	    client_socket = optarg;
+	    break;
+	case 'o':
+	    do_coprocess = true;
+	    break;
+	case 'k':
+	    do_compact = true;
+	    if(optarg) {
+		char* end;
+		days = std::strtoul(optarg, &end, 10);
+		if(!std::isdigit(*optarg) || *end) {
+		    std::cerr << usage_compact << '\n';
+		    return 1;
+		}
+	    }
+	    break;
 	case '!':
-	    std::cout << usage << '\n';
+	    std::cout << usage << '\n'
+		      << usage_tar << '\n'
+		      << usage_carve << '\n'
+		      << usage_compact << '\n'
+		      << usage_serve << '\n'
+		      << usage_client << '\n'
+		      << usage_coprocess << '\n';
 	    return 0;
 	case 'v':
 	    std::cout << "anydim 1.5\n"
-		      << "Copyright (c) 2011, 2019, 2021 Jrgen Grahn\n";
+		      << "Copyright (c) 2011, 2019, 2021 Jörgen Grahn\n";
 	    return 0;
 	    break;
 	case ':':
@@ -122,30 +694,201 @@ int main(int argc, char ** argv)
 	}
     }
 
+    if(do_compact) {
+	if(!cache_file) {
+	    std::cerr << usage_compact << '\n';
+	    return 1;
+	}
+	try {
+	    const auto n = anydim::Cache::compact(cache_file, days);
+	    if(do_stats) std::cerr << "cache entries: " << n << '\n';
+	}
+	catch (const std::system_error& err) {
+	    std::cerr << err.what() << '\n';
+	    return 1;
+	}
+	return 0;
+    }
+
+    if(client_socket) {
+	bool do_filenames = argc-optind > 1;
+	switch(hflag) {
+	case 'h': do_filenames = false; break;
+	case 'H': do_filenames = true; break;
+	}
+	const Format fmt {do_mime, do_filenames, do_landscape};
+	const std::vector<string> files(argv + optind, argv + argc);
+	auto put = [&fmt] (const char* file, const anydim::Result& res) {
+		       return report(std::cout, file, res, fmt);
+		   };
+	return client(client_socket, files, put)? 0: 1;
+    }
+
+    std::unique_ptr<anydim::Cache> cache;
+    if(cache_file) {
+	try {
+	    cache.reset(new anydim::Cache {cache_file});
+	}
+	catch (const std::system_error& err) {
+	    std::cerr << err.what() << '\n';
+	    return 1;
+	}
+	options.cache = cache.get();
+    }
+
+    anydim::Memo memo;
+    if(do_memo) options.memo = &memo;
+
+    if(serve_socket) {
+	if(optind!=argc) {
+	    std::cerr << usage_serve << '\n';
+	    return 1;
+	}
+	try {
+	    Server server {serve_socket, options, jobs, 4096};
+	    const bool ok = server.run();
+	    if(do_stats) {
+		server.put(std::cerr);
+		if(cache) cache->put(std::cerr);
+		if(do_memo) memo.put(std::cerr);
+	    }
+	    return ok? 0: 1;
+	}
+	catch (const std::system_error& err) {
+	    std::cerr << err.what() << '\n';
+	    return 1;
+	}
+    }
+
+    if(do_coprocess) {
+	if(optind!=argc) {
+	    std::cerr << usage_coprocess << '\n';
+	    return 1;
+	}
+	const Format fmt {do_mime, false, do_landscape};
+	const bool ok = coprocess(std::cin, std::cout, options, fmt, jobs);
+	if(do_stats) {
+	    stats.put(std::cerr);
+	    if(cache) cache->put(std::cerr);
+	    if(do_memo) memo.put(std::cerr);
+	}
+	return ok? 0: 1;
+    }
+
     int rc = 0;
+    std::unique_ptr<Concurrency> concurrency;
+    if(adaptive) concurrency.reset(new Concurrency {jobs});
 
-    if(optind==argc) {
-	if(!dimensions(std::cout, 0,
-		       do_mime, false,
-		       do_exif, do_landscape)) {
+    if(do_carve) {
+	if(optind==argc) {
+	    std::cerr << usage_carve << '\n';
+	    return 1;
+	}
+	const bool name = hflag ? hflag=='H' : argc-optind > 1;
+	const Format fmt {true, true, do_landscape};
+	for(int i=optind; i<argc; i++) {
+	    if(!carve(std::cout, argv[i], name, options, fmt, jobs)) rc = 1;
+	}
+    }
+    else if(do_archive) {
+	const Format fmt {do_mime, hflag!='h', do_landscape};
+	const bool zip = do_archive=='z';
+	if(optind==argc && !archive(std::cout, 0, zip, options, fmt)) rc = 1;
+	for(int i=optind; i<argc; i++) {
+	    if(!archive(std::cout, argv[i], zip, options, fmt)) rc = 1;
+	}
+    }
+    else if(optind==argc && roots.empty() && !files_from &&
+	    watches.empty()) {
+	const Format fmt {do_mime, false, do_landscape};
+	if(!dimensions(std::cout, 0, options, fmt)) {
 	    rc = 1;
 	}
     }
     else {
-	bool do_filenames = (argc-optind > 1);
+	bool do_filenames = (argc-optind > 1) || !roots.empty() || files_from
+	    || !watches.empty();
 	switch(hflag) {
 	case 'h': do_filenames = false; break;
 	case 'H': do_filenames = true; break;
 	}
 
-	for(int i=optind; i<argc; i++) {
-	    if(!dimensions(std::cout, argv[i],
-			   do_mime, do_filenames,
-			   do_exif, do_landscape)) {
-		rc = 1;
+	const Format fmt {do_mime, do_filenames, do_landscape};
+
+	/* Watching never ends, so each result should be seen as soon
+	 * as it's there.  io_uring only reaps while it's being fed, so
+	 * the watch uses threads instead.
+	 */
+	if(!watches.empty()) {
+	    std::cout << std::unitbuf;
+	    uring = 0;
+	}
+
+	std::unique_ptr<Throttle> throttle;
+	if(octet_rate || file_rate) {
+	    throttle.reset(new Throttle {octet_rate, file_rate});
+	    options.budget = throttle.get();
+	}
+	auto batch = [&] (Reorder* reorder) {
+			 return ::batch(std::cout, reorder, throttle.get(),
+					concurrency.get(),
+					options, fmt, jobs, uring, ordered);
+		     };
+
+	auto fill = [&] (Batch& batch) {
+			bool ok = true;
+			for(int i=optind; i<argc; i++) {
+			    batch.push(argv[i]);
+			}
+			if(files_from) {
+			    const bool use_stdin = string(files_from)=="-";
+			    std::ifstream inf;
+			    if(!use_stdin) inf.open(files_from);
+			    std::istream& in = use_stdin? std::cin: inf;
+			    if(!in || !push_all(batch, in, delim)) {
+				std::cerr << files_from << ": "
+					  << std::strerror(errno) << '\n';
+				ok = false;
+			    }
+			}
+			if(!roots.empty()) {
+			    Walk walk {batch, filter,
+				       adaptive? auto_walkers: jobs};
+			    if(!walk.walk(roots)) ok = false;
+			}
+			if(!watches.empty()) {
+			    Watch watch {batch, filter};
+			    if(!watch.watch(watches)) ok = false;
+			}
+			return ok;
+		    };
+
+	if(!physical) {
+	    auto b = batch(nullptr);
+	    if(!fill(*b)) rc = 1;
+	    if(!b->join()) rc = 1;
+	}
+	else {
+	    List list;
+	    if(!fill(list)) rc = 1;
+
+	    Reorder reorder {list.files};
+	    auto b = batch(&reorder);
+	    const int flags = options.gentle? O_NOATIME: 0;
+	    for(size_t i : physical_order(list.files, flags,
+					  throttle.get())) {
+		b->push(list.files[i]);
 	    }
+	    if(!b->join()) rc = 1;
+	    reorder.write(std::cout);
 	}
     }
 
+    if(do_stats) {
+	stats.put(std::cerr);
+	if(concurrency) concurrency->put(std::cerr);
+	if(cache) cache->put(std::cerr);
+	if(do_memo) memo.put(std::cerr);
+    }
     return rc;
 }
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "memo.h"
+
+#include <iostream>
+#include <algorithm>
+#include <mutex>
+
+using anydim::Memo;
+
+
+namespace {
+
+    /* FNV-1a, which is cheap enough for the few hundred octets of a
+     * typical header, and can be extended one octet at a time.
+     */
+    const uint64_t basis = 0xcbf29ce484222325;
+    const uint64_t prime = 0x100000001b3;
+}
+
+
+constexpr size_t Memo::most;
+
+anydim::Trace::Trace()
+    : hash {basis}
+{}
+
+void anydim::Trace::reset()
+{
+    head.clear();
+    hash = basis;
+    hashed = 0;
+    on = true;
+}
+
+/**
+ * Extend the hash to cover the first 'n' octets of the head.
+ */
+void anydim::Trace::advance(size_t n)
+{
+    for (; hashed < n; hashed++) {
+	hash = (hash ^ head[hashed]) * prime;
+    }
+}
+
+
+Memo::Memo(size_t size)
+    : size {size}
+{}
+
+/**
+ * Look for a header which the trace's head starts with, and which
+ * ends past 'from', i.e. in the octets added since the last find().
+ */
+bool Memo::find(Trace& trace, size_t from, Answer& answer)
+{
+    std::shared_lock<std::shared_timed_mutex> lock {mutex};
+
+    const size_t to = trace.head.size();
+    for (auto it = lengths.upper_bound(from); it!=end(lengths) && *it <= to; ++it) {
+	const size_t n = *it;
+	trace.advance(n);
+	const auto range = entries.equal_range(trace.hash);
+	for (auto e = range.first; e!=range.second; ++e) {
+	    const auto& head = e->second.head;
+	    if (head.size()!=n) continue;
+	    if (!std::equal(begin(head), end(head), begin(trace.head))) continue;
+	    answer = e->second.answer;
+	    hits++;
+	    return true;
+	}
+    }
+    return false;
+}
+
+/**
+ * Remember the 'answer', which was decided after the first
+ * answer.length octets of the trace.
+ */
+void Memo::insert(const Trace& trace, const Answer& answer)
+{
+    const size_t n = answer.length;
+    if (!n || n > trace.head.size() || n > most) return;
+
+    Trace t;
+    t.head.assign(begin(trace.head), begin(trace.head) + n);
+    t.advance(n);
+
+    std::lock_guard<std::shared_timed_mutex> lock {mutex};
+    if (octets + n > size) return;
+
+    const auto range = entries.equal_range(t.hash);
+    for (auto e = range.first; e!=range.second; ++e) {
+	if (e->second.head==t.head) return;
+    }
+    entries.emplace(t.hash, Entry {std::move(t.head), answer});
+    lengths.insert(n);
+    octets += n;
+}
+
+void Memo::put(std::ostream& os) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock {mutex};
+    os << "memo hits:     " << hits << '\n'
+       << "memo headers:  " << entries.size() << '\n';
+}
@@ -0,0 +1,93 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_MEMO_H
+#define ANYDIM_MEMO_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <stdint.h>
+
+namespace anydim {
+
+    /**
+     * The octets seen so far of a file, for looking it up in a Memo,
+     * and how far we've hashed them.  Off once something has been
+     * skipped, or there's too much.
+     */
+    struct Trace {
+	std::vector<uint8_t> head;
+	uint64_t hash;
+	size_t hashed = 0;
+	bool on = true;
+
+	Trace();
+	void advance(size_t n);
+	void reset();
+    };
+
+    /**
+     * A memo of the headers AnyDim has decided on during this run:
+     * the exact octets from the start of a file up to the point where
+     * the decision was made, and the outcome.  A later file which
+     * starts with the same octets has the same dimensions, so an
+     * AnyDim with a Memo looks there before running its decoders.
+     * That pays off for sequences of frames with byte-identical
+     * headers, like those rendered or captured in bulk.
+     *
+     * Only the octets are compared, so the Memo must only be used with
+     * one 'use_exif' setting.  Only headers which were read without
+     * skipping anything, and which are no larger than 'most' octets,
+     * are memoized; a JPEG with a huge ICC profile is not.  Once the
+     * memo holds 'size' octets, it takes no more.
+     *
+     * Lookups are by a hash of the prefix for each header length in
+     * the memo, and then an exact comparison.  It may be used by many
+     * threads at once.
+     */
+    class Memo {
+    public:
+	explicit Memo(size_t size = 16 << 20);
+	Memo(const Memo&) = delete;
+	Memo& operator= (const Memo&) = delete;
+
+	static constexpr size_t most = 64 << 10;
+
+	struct Answer {
+	    const char* mime;
+	    unsigned width;
+	    unsigned height;
+	    size_t length;
+	};
+
+	bool find(Trace& trace, size_t from, Answer& answer);
+	void insert(const Trace& trace, const Answer& answer);
+
+	void put(std::ostream& os) const;
+
+    private:
+	struct Entry {
+	    std::vector<uint8_t> head;
+	    Answer answer;
+	};
+
+	const size_t size;
+
+	mutable std::shared_timed_mutex mutex;
+	std::unordered_multimap<uint64_t, Entry> entries;
+	std::set<size_t> lengths;
+	size_t octets = 0;
+
+	std::atomic<unsigned long> hits {0};
+    };
+}
+
+#endif
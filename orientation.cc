@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021 Jrgen Grahn
+ * Copyright (c) 2021 Jörgen Grahn
  * All rights reserved.
  *
  */
@@ -1,4 +1,4 @@
-/* Copyright (c) 2021 Jrgen Grahn
+/* Copyright (c) 2021 Jörgen Grahn
  * All rights reserved.
  *
  */
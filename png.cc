@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "png.h"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+
+namespace {
+
+    const uint8_t signature[] = {
+	0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a
+    };
+
+    unsigned eat32(const uint8_t*& p)
+    {
+	unsigned n = 0;
+	n = (n<<8) | *p++;
+	n = (n<<8) | *p++;
+	n = (n<<8) | *p++;
+	n = (n<<8) | *p++;
+	return n;
+    }
+}
+
+
+std::vector<png::Chunk> png::chunks(const uint8_t* a, const uint8_t* b)
+{
+    if (size_t(b-a) < sizeof signature ||
+	!std::equal(signature, signature + sizeof signature, a)) {
+	throw Error {};
+    }
+    a += sizeof signature;
+
+    std::vector<Chunk> v;
+    while (b-a >= 8) {
+	const uint8_t* p = a;
+	const size_t len = eat32(p);
+	if (len > 0x7fffffff) throw Error {};
+	if (size_t(b-p) < 4 + len + 4) break;
+
+	const uint8_t* const data = p + 4;
+	const uint8_t* const end = data + len;
+	p = end;
+	const unsigned crc = eat32(p);
+	if (crc!=crc32(0, a + 4, 4 + len)) throw Error {};
+
+	Chunk chunk {std::string(a + 4, data), {data, end}};
+	if (chunk.type=="IDAT") break;
+	v.push_back(std::move(chunk));
+	if (v.back().type=="IEND") break;
+	a = p;
+    }
+    return v;
+}
+
+std::map<std::string, std::string> png::text(const std::vector<Chunk>& v)
+{
+    std::map<std::string, std::string> m;
+    for (const Chunk& chunk : v) {
+	if (chunk.type!="tEXt") continue;
+	auto a = begin(chunk.v);
+	auto b = end(chunk.v);
+	auto nul = std::find(a, b, 0);
+	if (nul==b) continue;
+	m.emplace(std::string(a, nul), std::string(nul+1, b));
+    }
+    return m;
+}
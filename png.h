@@ -0,0 +1,47 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * The PNG file format, as far as we need it (see RFC 2083):
+ *
+ * - A file is an 8-octet signature followed by a sequence of chunks.
+ * - A chunk is a 32-bit big-endian length, a 4-letter type, 'length'
+ *   octets of data, and a CRC-32 of the type and data.
+ * - IHDR comes first, and the image data is in one or more IDAT.
+ *   The file ends with IEND.
+ * - A tEXt chunk is a keyword, a NUL, and the text (Latin-1, not
+ *   NUL-terminated).  Metadata like that is normally written before
+ *   the IDATs.
+ */
+#ifndef ANYDIM_PNG_H
+#define ANYDIM_PNG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace png {
+
+    class Error {};
+
+    struct Chunk {
+	std::string type;
+	std::vector<uint8_t> v;
+    };
+
+    /**
+     * The chunks of the PNG file which starts with [a, b), up to the
+     * first IDAT, or as many of them as are complete in [a, b).
+     * Throws Error if it's not a PNG file, or a chunk is corrupt.
+     */
+    std::vector<Chunk> chunks(const uint8_t* a, const uint8_t* b);
+
+    /**
+     * The keywords and texts of the tEXt chunks among 'v'.
+     */
+    std::map<std::string, std::string> text(const std::vector<Chunk>& v);
+}
+
+#endif
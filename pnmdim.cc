@@ -1,6 +1,6 @@
 /* $Id: pnmdim.cc,v 1.2 2011-01-07 22:34:04 grahn Exp $
  *
- * Copyright (c) 2011 Jrgen Grahn
+ * Copyright (c) 2011 Jörgen Grahn
  * All rights reserved.
  *
  */
@@ -53,10 +53,11 @@ const char* PnmDim::mime() const
 
 void PnmDim::feed(const uint8_t *a, const uint8_t *b)
 {
-    while(a!=b) {
+    while(a!=b && state_==UNDECIDED) {
 	char ch = *a++;
 	feed(ch);
     }
+    unused_ = b-a;
 }
 
 
@@ -66,6 +67,15 @@ void PnmDim::eof()
 }
 
 
+void PnmDim::reset()
+{
+    Dim::reset();
+    comment_ = false;
+    pnmstate_ = WANT_P;
+    mime_ = "";
+}
+
+
 /* Simple state machine which goes like this:
  * 
  * P N WS1A WS1B+ W+ WS2+ H+
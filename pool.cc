@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "pool.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+
+Pool::Pool(std::ostream& os, const Task& task,
+	   unsigned n, bool ordered, Concurrency* concurrency)
+    : os {os},
+      task {task},
+      ordered {ordered},
+      window {16 * n},
+      concurrency {concurrency}
+{
+    if (n < 2) return;
+
+    for (unsigned i=0; i<n; i++) {
+	workers.emplace_back(&Pool::run, this);
+    }
+}
+
+Pool::~Pool()
+{
+    join();
+}
+
+/**
+ * Queue 'file' for probing, blocking while there's no room in the
+ * queue.  Without workers, probe it right away.
+ */
+void Pool::push(const std::string& file)
+{
+    const dev_t dev = concurrency ? concurrency->device(file) : 0;
+
+    if (workers.empty()) {
+	if (concurrency) concurrency->acquire(dev);
+	if (!task(os, file)) ok = false;
+	return;
+    }
+
+    std::unique_lock<std::mutex> lock {mutex};
+    room.wait(lock, [this] {
+		      if (ordered) return pushed - written < window;
+		      return queue.size() < window;
+		  });
+    queue.push_back({pushed++, file, dev});
+    work.notify_all();
+}
+
+bool Pool::join()
+{
+    {
+	std::lock_guard<std::mutex> lock {mutex};
+	closing = true;
+    }
+    work.notify_all();
+
+    for (auto& t : workers) t.join();
+    workers.clear();
+    return ok;
+}
+
+/**
+ * The worker thread: run tasks from the queue until it's empty and
+ * the pool is closing.
+ */
+void Pool::run()
+{
+    std::unique_lock<std::mutex> lock {mutex};
+
+    while (true) {
+	auto it = end(queue);
+	work.wait(lock, [this, &it] {
+			  it = next();
+			  return it!=end(queue) || (closing && queue.empty());
+		      });
+	if (it==end(queue)) break;
+
+	const auto seq = it->seq;
+	const std::string file = std::move(it->file);
+	queue.erase(it);
+	room.notify_one();
+
+	lock.unlock();
+	std::ostringstream ss;
+	const bool success = task(ss, file);
+	lock.lock();
+
+	finish(seq, ss.str(), success);
+	/* its device has room again */
+	if (concurrency) work.notify_all();
+    }
+}
+
+/**
+ * The queued file to probe next: the first one, or with a Concurrency,
+ * the first one whose device admits another probe.  Called with the
+ * mutex held.
+ */
+std::deque<Pool::Entry>::iterator Pool::next()
+{
+    if (!concurrency) return begin(queue);
+    return std::find_if(begin(queue), end(queue),
+			[this] (const Entry& e) {
+			    return concurrency->admit(e.dev);
+			});
+}
+
+/**
+ * Write the result 's' of task 'seq', or (if we're writing in order
+ * and it isn't its turn yet) set it aside until it is.
+ * Called with the mutex held.
+ */
+void Pool::finish(unsigned long seq, const std::string& s, bool success)
+{
+    if (!success) ok = false;
+
+    if (!ordered) {
+	os << s;
+	written++;
+	return;
+    }
+
+    done.emplace(seq, s);
+    while (!done.empty() && done.begin()->first==written) {
+	os << done.begin()->second;
+	done.erase(done.begin());
+	written++;
+    }
+    room.notify_all();
+}
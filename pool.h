@@ -0,0 +1,89 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_POOL_H
+#define ANYDIM_POOL_H
+
+#include "batch.h"
+#include "concurrency.h"
+
+#include <iosfwd>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <vector>
+
+/**
+ * A Batch which is a pool of worker threads, running a Task on each
+ * file name push()ed to it, and writing the results to an ostream.
+ *
+ * The output of each task is buffered, and written either in the
+ * order the files were pushed, or (if not 'ordered') in the order the
+ * tasks finish.  With a single worker there are no threads; the task
+ * simply runs in push().
+ *
+ * Memory use is bounded: push() blocks while too many files are
+ * queued, running, or waiting for their turn to be written.
+ *
+ * With a Concurrency, a worker takes the first queued file whose
+ * device has room for another probe, and its task is expected to take
+ * the Concurrency::Permit for it.  A worker doesn't take a file it
+ * would have to wait for, so files on other devices aren't stuck
+ * behind those of a saturated one.
+ *
+ * join() waits for all tasks to finish, and returns false if any of
+ * them failed.
+ */
+class Pool final : public Batch {
+public:
+    using Task = std::function<bool(std::ostream&, const std::string&)>;
+
+    Pool(std::ostream& os, const Task& task,
+	 unsigned workers, bool ordered,
+	 Concurrency* concurrency = nullptr);
+    ~Pool();
+    Pool(const Pool&) = delete;
+    Pool& operator= (const Pool&) = delete;
+
+    void push(const std::string& file) override;
+    bool join() override;
+
+private:
+    std::ostream& os;
+    const Task task;
+    const bool ordered;
+    const unsigned window;
+    Concurrency* const concurrency;
+
+    struct Entry {
+	unsigned long seq;
+	std::string file;
+	dev_t dev;
+    };
+
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable room;
+
+    std::deque<Entry> queue;
+    std::map<unsigned long, std::string> done;
+    unsigned long pushed = 0;
+    unsigned long written = 0;
+    bool closing = false;
+    bool ok = true;
+
+    std::vector<std::thread> workers;
+
+    void run();
+    std::deque<Entry>::iterator next();
+    void finish(unsigned long seq, const std::string& s, bool success);
+};
+
+#endif
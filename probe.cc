@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "anydim.h"
+#include "cache.h"
+#include "thumb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using anydim::Result;
+
+
+Result::Result(const Dim& dim)
+{
+    decided(dim);
+}
+
+/**
+ * Take the outcome from 'dim', which is no longer undecided.
+ */
+void Result::decided(const Dim& dim)
+{
+    bad = dim.bad();
+    mime = dim.mime();
+    width = dim.width;
+    height = dim.height;
+}
+
+void Result::decided(const AnyDim& dim)
+{
+    decided(static_cast<const Dim&>(dim));
+    limited = bad && dim.limited();
+}
+
+/**
+ * Account for reading 'n' octets at 'offset'.  The reads are assumed
+ * to be in order, so a page is counted once even if two reads touch
+ * it.
+ */
+void Result::tally(uint64_t offset, size_t n)
+{
+    static const uint64_t size = sysconf(_SC_PAGESIZE);
+
+    const uint64_t a = std::max(offset / size,
+				(this->offset + size - 1) / size);
+    const uint64_t b = (offset + n + size - 1) / size;
+    if (b > a) pages += b - a;
+
+    octets += n;
+    this->offset = offset + n;
+}
+
+
+namespace {
+
+    /**
+     * The point in time when a probe gives up, if Options::timeout
+     * is set.
+     */
+    class Deadline {
+    public:
+	using clock = std::chrono::steady_clock;
+
+	explicit Deadline(unsigned ms)
+	    : set {ms!=0},
+	      t {clock::now() + std::chrono::milliseconds(ms)}
+	{}
+
+	bool passed() const { return set && clock::now() >= t; }
+
+    private:
+	const bool set;
+	const clock::time_point t;
+    };
+
+    /**
+     * Read into [a, a+n) at 'offset', or (if 'fd' isn't seekable)
+     * from wherever it's positioned.  Returns what read(2) returns,
+     * except it's never -1 with EINTR: an interruption after the
+     * deadline is ETIMEDOUT, and before it we simply try again.
+     */
+    ssize_t read(int fd, uint8_t* a, size_t n, off_t offset, bool& seekable,
+		 const Deadline& deadline)
+    {
+	while (true) {
+	    ssize_t rc = seekable? pread(fd, a, n, offset): ::read(fd, a, n);
+	    if (rc==-1 && errno==ESPIPE && seekable) {
+		seekable = false;
+		continue;
+	    }
+	    if (rc==-1 && errno==EINTR) {
+		if (!deadline.passed()) continue;
+		errno = ETIMEDOUT;
+	    }
+	    return rc;
+	}
+    }
+
+    /**
+     * Like read() above, but first taking the octets from the
+     * 'budget', if there is one, and giving back what wasn't read.
+     */
+    ssize_t read(int fd, uint8_t* a, size_t n, off_t offset, bool& seekable,
+		 const Deadline& deadline, anydim::Budget* budget)
+    {
+	if (!budget) return read(fd, a, n, offset, seekable, deadline);
+	budget->read(n);
+	const ssize_t rc = read(fd, a, n, offset, seekable, deadline);
+	if (rc < ssize_t(n)) budget->unread(n - std::max(rc, ssize_t(0)));
+	return rc;
+    }
+
+    /**
+     * Skip 'n' octets of a file which isn't seekable, by reading
+     * and discarding them.
+     */
+    ssize_t discard(int fd, uint8_t* buf, size_t size, size_t n,
+		    const Deadline& deadline, anydim::Budget* budget)
+    {
+	bool seekable = false;
+	while (n) {
+	    const ssize_t rc = read(fd, buf, std::min(n, size), 0, seekable,
+				    deadline, budget);
+	    if (rc <= 0) return rc;
+	    n -= rc;
+	}
+	return 1;
+    }
+
+    Result failure(Result res, int err)
+    {
+	res.error = err;
+	return res;
+    }
+
+    /**
+     * An AnyDim for the options, ready for a new file.  There's one
+     * per thread, reset between files rather than built anew with
+     * its decoders and their buffers, as long as the options it
+     * depends on stay the same.
+     */
+    anydim::AnyDim& decoder(const anydim::Options& options)
+    {
+	struct Decoder {
+	    bool use_exif;
+	    uint64_t max_octets;
+	    anydim::Memo* memo;
+	    std::unique_ptr<anydim::AnyDim> dim;
+	};
+	thread_local Decoder d;
+
+	if (d.dim && d.use_exif==options.use_exif &&
+	    d.max_octets==options.max_octets && d.memo==options.memo) {
+	    d.dim->reset();
+	    return *d.dim;
+	}
+	d = {options.use_exif, options.max_octets, options.memo,
+	     std::unique_ptr<anydim::AnyDim> {
+		 new anydim::AnyDim {options.use_exif, options.max_octets,
+				     options.memo}}};
+	return *d.dim;
+    }
+
+    /**
+     * For gentle probing: drops what 'res' says was read of 'fd'
+     * from the page cache on the way out, however the probe ends.
+     * Slow and failed reads are the ones most worth dropping.
+     */
+    class Dontneed {
+    public:
+	Dontneed(bool gentle, int fd, const Result& res, const bool& seekable)
+	    : gentle {gentle}, fd {fd}, res (res), seekable (seekable)
+	{}
+	Dontneed(const Dontneed&) = delete;
+	Dontneed& operator= (const Dontneed&) = delete;
+	~Dontneed()
+	{
+	    if (gentle && seekable) {
+		posix_fadvise(fd, 0, res.offset, POSIX_FADV_DONTNEED);
+	    }
+	}
+
+    private:
+	const bool gentle;
+	const int fd;
+	const Result& res;
+	const bool& seekable;
+    };
+
+    Result probe(int fd, const anydim::Options& options,
+		 const Deadline& deadline)
+    {
+	anydim::AnyDim& dim = decoder(options);
+	Result res;
+	uint8_t buf[4096];
+	off_t offset = 0;
+	bool seekable = true;
+
+	const Dontneed dontneed {options.gentle, fd, res, seekable};
+	if (options.gentle) posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+
+	while (dim.undecided()) {
+	    if (deadline.passed()) return failure(res, ETIMEDOUT);
+	    const size_t want = dim.want();
+	    const size_t size = want? std::min(want, sizeof buf): sizeof buf;
+	    const ssize_t n = read(fd, buf, size, offset, seekable,
+				    deadline, options.budget);
+	    if (n==-1) return failure(res, errno);
+	    if (n==0) {
+		dim.eof();
+		break;
+	    }
+	    res.tally(offset, n);
+	    dim.feed(buf, buf + n);
+	    offset += n;
+
+	    const size_t skip = dim.skippable();
+	    if (skip) {
+		if (!seekable &&
+		    discard(fd, buf, sizeof buf, skip, deadline,
+			    options.budget)==-1) {
+		    return failure(res, errno);
+		}
+		dim.skip(skip);
+		offset += skip;
+	    }
+	}
+
+	res.decided(dim);
+	return res;
+    }
+
+    /**
+     * Find the result for the regular file 'path' (or if it's null,
+     * 'fd') without reading it: in the cache, in its extended
+     * attribute, or in its thumbnail, if the options say so.
+     */
+    bool recall(const char* path, int fd, const anydim::Options& options,
+		Result& res)
+    {
+	const bool thumbnails = options.thumbnails && path;
+	if (!options.cache && !options.xattr && !thumbnails) return false;
+
+	struct stat st;
+	if ((path ? stat(path, &st) : fstat(fd, &st)) || !S_ISREG(st.st_mode)) {
+	    return false;
+	}
+	const anydim::Cache::Key key {st, options.use_exif};
+	if (options.cache && options.cache->find(key, res)) return true;
+
+	if (options.xattr && (path ? anydim::get_xattr(path, key, res)
+			      : anydim::get_xattr(fd, key, res))) {
+	    if (options.cache) options.cache->insert(key, res);
+	    return true;
+	}
+
+	/* a guess, which isn't worth caching */
+	return thumbnails &&
+	    anydim::get_thumbnail(path, key, options.use_exif, res);
+    }
+
+    /**
+     * Remember 'res' for the open file 'fd', if it's a regular file,
+     * where the options say so.  The key comes from the file we
+     * actually read, not whatever the path names by now.
+     */
+    void remember(int fd, const anydim::Options& options, const Result& res)
+    {
+	struct stat st;
+	if (!options.cache && !options.xattr) return;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode)) return;
+
+	const anydim::Cache::Key key {st, options.use_exif};
+	if (options.cache) options.cache->insert(key, res);
+	if (options.xattr) anydim::set_xattr(fd, key, res);
+    }
+
+    /**
+     * open(2), but an interruption after the deadline is ETIMEDOUT,
+     * and before it we simply try again.
+     */
+    int open(const char* path, int flags, const Deadline& deadline)
+    {
+	while (true) {
+	    const int fd = ::open(path, flags);
+	    if (fd==-1 && errno==EINTR) {
+		if (!deadline.passed()) continue;
+		errno = ETIMEDOUT;
+	    }
+	    return fd;
+	}
+    }
+}
+
+
+Result anydim::probe(int fd, const Options& options)
+{
+    Result res;
+    if (recall(nullptr, fd, options, res)) return res;
+
+    res = ::probe(fd, options, Deadline {options.timeout});
+    remember(fd, options, res);
+    return res;
+}
+
+
+/**
+ * The decoder is the same one probe(int, const Options&) uses, so a
+ * thread which probes many buffers builds it once.
+ */
+Result anydim::probe(const uint8_t* a, const uint8_t* b,
+		     const Options& options)
+{
+    anydim::AnyDim& dim = decoder(options);
+    Result res;
+    dim.feed(a, b);
+    if (dim.undecided()) dim.eof();
+    res.decided(dim);
+    return res;
+}
+
+
+/**
+ * With a cache, a file found there costs a single stat(2), and one
+ * found in its extended attribute a getxattr(2) more; it's not even
+ * opened.
+ */
+Result anydim::probe(const char* path, const Options& options)
+{
+    Result res;
+    if (recall(path, -1, options, res)) return res;
+
+    const Deadline deadline {options.timeout};
+    const int flags = O_RDONLY | O_CLOEXEC;
+    int fd = -1;
+    if (options.gentle) {
+	/* O_NOATIME is only for the file's owner (or root) */
+	fd = open(path, flags | O_NOATIME, deadline);
+    }
+    if (fd==-1 && (!options.gentle || errno==EPERM)) {
+	fd = open(path, flags, deadline);
+    }
+    if (fd==-1) return failure(Result {}, errno);
+
+    res = ::probe(fd, options, deadline);
+    remember(fd, options, res);
+    close(fd);
+    return res;
+}
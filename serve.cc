@@ -0,0 +1,620 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "serve.h"
+#include "alarm.h"
+
+#include <iostream>
+#include <sstream>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <future>
+#include <cstring>
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using anydim::Result;
+
+
+namespace {
+
+    std::system_error failure(const std::string& path, int err = errno)
+    {
+	return std::system_error {err, std::generic_category(), path};
+    }
+
+    bool address(const std::string& path, sockaddr_un& sa)
+    {
+	sa = sockaddr_un {};
+	sa.sun_family = AF_UNIX;
+	if (path.size() >= sizeof sa.sun_path) return false;
+	std::strcpy(sa.sun_path, path.c_str());
+	return true;
+    }
+
+    /**
+     * A socket listening on 'path'.  A socket file left behind by a
+     * server which is gone is replaced, but one with a server
+     * listening on it is not.
+     */
+    int listen(const std::string& path)
+    {
+	sockaddr_un sa;
+	if (!address(path, sa)) throw failure(path, ENAMETOOLONG);
+	const auto addr = reinterpret_cast<const sockaddr*>(&sa);
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd==-1) throw failure(path);
+
+	int err = bind(fd, addr, sizeof sa) ? errno : 0;
+	if (err==EADDRINUSE) {
+	    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	    const bool taken = connect(probe, addr, sizeof sa)==0;
+	    close(probe);
+	    if (!taken && unlink(path.c_str())==0) {
+		err = bind(fd, addr, sizeof sa) ? errno : 0;
+	    }
+	}
+	if (!err && ::listen(fd, 128)) err = errno;
+	if (err) {
+	    close(fd);
+	    throw failure(path, err);
+	}
+	return fd;
+    }
+
+    bool send_all(int fd, const std::string& s)
+    {
+	const char* a = s.data();
+	const char* const b = a + s.size();
+	while (a!=b) {
+	    const ssize_t n = send(fd, a, b-a, MSG_NOSIGNAL);
+	    if (n==-1 && errno==EINTR) continue;
+	    if (n==-1) return false;
+	    a += n;
+	}
+	return true;
+    }
+
+    /**
+     * Send a single line with 'fd' attached.
+     */
+    bool send_fd(int sock, const std::string& line, int fd)
+    {
+	char cbuf[CMSG_SPACE(sizeof fd)] = {};
+	iovec iov {const_cast<char*>(line.data()), line.size()};
+	msghdr msg {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof cbuf;
+	cmsghdr* const c = CMSG_FIRSTHDR(&msg);
+	c->cmsg_level = SOL_SOCKET;
+	c->cmsg_type = SCM_RIGHTS;
+	c->cmsg_len = CMSG_LEN(sizeof fd);
+	std::memcpy(CMSG_DATA(c), &fd, sizeof fd);
+	return sendmsg(sock, &msg, MSG_NOSIGNAL)==ssize_t(line.size());
+    }
+
+    /**
+     * Take the next line from 'buf', reading more from 'fd' as
+     * needed.  False at end of file, or on error.
+     */
+    bool getline(int fd, std::string& buf, std::string& line)
+    {
+	while (true) {
+	    const auto nl = buf.find('\n');
+	    if (nl!=std::string::npos) {
+		line = buf.substr(0, nl);
+		buf.erase(0, nl+1);
+		return true;
+	    }
+	    char tmp[4096];
+	    const ssize_t n = read(fd, tmp, sizeof tmp);
+	    if (n==-1 && errno==EINTR) continue;
+	    if (n <= 0) return false;
+	    buf.append(tmp, n);
+	}
+    }
+
+    std::string format(const Result& res)
+    {
+	std::ostringstream ss;
+	ss << res.error << ' ' << res.bad << ' ' << res.mime << ' '
+	   << res.width << ' ' << res.height << '\n';
+	return ss.str();
+    }
+}
+
+
+/**
+ * The results for the most recent file names, each with an inotify
+ * watch on the file.  A watch fires once; then the results for the
+ * file are forgotten.  A watch which fires while its file is being
+ * probed bumps its generation, so that the (possibly stale) result
+ * isn't kept.
+ *
+ * The watch is on the file, not its name, and the name may come to
+ * mean another file without it firing, e.g. if a parent directory is
+ * renamed.  So each entry also has the device and inode the name had,
+ * and a hit only counts if the name still has them.
+ */
+struct Server::Lru {
+    explicit Lru(size_t size);
+    ~Lru();
+
+    bool find(const std::string& file, const struct stat& st, Result& res);
+    int watch(const std::string& file, unsigned long& gen);
+    void insert(const std::string& file, const struct stat& st,
+		const Result& res, int wd, unsigned long gen);
+
+    struct Watch {
+	unsigned long gen = 0;
+	std::set<std::string> files;
+    };
+    struct Entry {
+	std::string file;
+	dev_t dev;
+	ino_t ino;
+	Result res;
+	int wd;
+    };
+    using List = std::list<Entry>;
+
+    const size_t size;
+    const int fd;
+    const int stop;
+
+    mutable std::mutex mutex;
+    List list;
+    std::unordered_map<std::string, List::iterator> index;
+    std::map<int, Watch> watches;
+    unsigned long hits = 0;
+    unsigned long misses = 0;
+    unsigned long invalidated = 0;
+
+    std::thread thread;
+
+    void run();
+    void invalidate(int wd);
+    void erase(List::iterator it);
+};
+
+Server::Lru::Lru(size_t size)
+    : size {size ? size : 1},
+      fd {inotify_init1(IN_CLOEXEC)},
+      stop {eventfd(0, EFD_CLOEXEC)}
+{
+    if (fd==-1 || stop==-1) throw failure("inotify");
+    thread = std::thread {&Lru::run, this};
+}
+
+Server::Lru::~Lru()
+{
+    const uint64_t one = 1;
+    if (write(stop, &one, sizeof one)) {}
+    thread.join();
+    close(stop);
+    close(fd);
+}
+
+/**
+ * Find the result for 'file', which stat(2) says is 'st' right now.
+ */
+bool Server::Lru::find(const std::string& file, const struct stat& st,
+		       Result& res)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    auto it = index.find(file);
+    if (it==end(index)) {
+	misses++;
+	return false;
+    }
+    const Entry& e = *it->second;
+    if (e.dev!=st.st_dev || e.ino!=st.st_ino) {
+	erase(it->second);
+	invalidated++;
+	misses++;
+	return false;
+    }
+    list.splice(begin(list), list, it->second);
+    res = e.res;
+    hits++;
+    return true;
+}
+
+/**
+ * Start watching 'file', before probing it.  Returns the watch
+ * descriptor, or -1.
+ */
+int Server::Lru::watch(const std::string& file, unsigned long& gen)
+{
+    const int wd = inotify_add_watch(fd, file.c_str(),
+				     IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF |
+				     IN_DELETE_SELF | IN_ONESHOT);
+    if (wd==-1) return -1;
+    std::lock_guard<std::mutex> lock {mutex};
+    gen = watches[wd].gen;
+    return wd;
+}
+
+/**
+ * Keep 'res' for 'file', which was 'st' before watch(), unless it's
+ * an error or the file has changed since watch().
+ */
+void Server::Lru::insert(const std::string& file, const struct stat& st,
+			 const Result& res, int wd, unsigned long gen)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    auto w = watches.find(wd);
+    if (w==end(watches)) return;
+    if (res.error || w->second.gen!=gen) {
+	if (w->second.files.empty()) inotify_rm_watch(fd, wd);
+	return;
+    }
+
+    auto it = index.find(file);
+    if (it!=end(index)) erase(it->second);
+
+    list.push_front({file, st.st_dev, st.st_ino, res, wd});
+    index[file] = begin(list);
+    w->second.files.insert(file);
+    if (list.size() > size) erase(std::prev(end(list)));
+}
+
+/**
+ * Forget the file at 'it', and its watch if no other name uses it.
+ */
+void Server::Lru::erase(List::iterator it)
+{
+    const std::string& file = it->file;
+    const int wd = it->wd;
+    auto& files = watches[wd].files;
+    files.erase(file);
+    if (files.empty()) inotify_rm_watch(fd, wd);
+    index.erase(file);
+    list.erase(it);
+}
+
+void Server::Lru::invalidate(int wd)
+{
+    auto w = watches.find(wd);
+    if (w==end(watches)) return;
+    w->second.gen++;
+    for (const std::string& file : w->second.files) {
+	auto it = index.find(file);
+	list.erase(it->second);
+	index.erase(it);
+	invalidated++;
+    }
+    w->second.files.clear();
+}
+
+/**
+ * The inotify thread.  If the event queue has overflowed, we don't
+ * know what has changed, so everything is forgotten.
+ */
+void Server::Lru::run()
+{
+    pollfd p[2] = {{fd, POLLIN, 0}, {stop, POLLIN, 0}};
+    alignas(inotify_event) char buf[16 * 1024];
+
+    while (true) {
+	if (poll(p, 2, -1)==-1 && errno!=EINTR) break;
+	if (p[1].revents) break;
+	if (!p[0].revents) continue;
+
+	const ssize_t n = read(fd, buf, sizeof buf);
+	if (n <= 0) continue;
+
+	std::lock_guard<std::mutex> lock {mutex};
+	for (const char* q = buf; q < buf + n; ) {
+	    const auto ev = reinterpret_cast<const inotify_event*>(q);
+	    q += sizeof *ev + ev->len;
+
+	    if (ev->mask & IN_Q_OVERFLOW) {
+		for (auto& w : watches) invalidate(w.first);
+		continue;
+	    }
+	    invalidate(ev->wd);
+	    if (ev->mask & IN_IGNORED) watches.erase(ev->wd);
+	}
+    }
+}
+
+
+/**
+ * Listen on 'path', and probe with 'workers' threads, keeping the
+ * results for up to 'size' file names.
+ */
+Server::Server(const std::string& path, const anydim::Options& options,
+	       unsigned workers, size_t size)
+    : path {path},
+      options {options},
+      fd {listen(path)}
+{
+    /* Only run() should see these, via its signalfd. */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    lru.reset(new Lru {size});
+    for (unsigned i=0; i < (workers ? workers : 1); i++) {
+	this->workers.emplace_back(&Server::worker, this);
+    }
+}
+
+Server::~Server()
+{
+    {
+	std::lock_guard<std::mutex> lock {mutex};
+	closing = true;
+	work.notify_all();
+    }
+    for (auto& t : workers) t.join();
+    close(fd);
+}
+
+/**
+ * Accept connections, each served by a thread of its own, until we're
+ * told to stop.  Then wait for the connections in progress to finish
+ * their current requests.
+ */
+bool Server::run()
+{
+    sigset_t set;
+    pthread_sigmask(SIG_BLOCK, nullptr, &set);
+    const int sfd = signalfd(-1, &set, SFD_CLOEXEC);
+    if (sfd==-1) {
+	std::cerr << path << ": " << std::strerror(errno) << '\n';
+	return false;
+    }
+
+    pollfd p[2] = {{fd, POLLIN, 0}, {sfd, POLLIN, 0}};
+    while (true) {
+	if (poll(p, 2, -1)==-1 && errno!=EINTR) break;
+	if (p[1].revents) break;
+	if (!p[0].revents) continue;
+
+	const int c = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+	if (c==-1) continue;
+	std::lock_guard<std::mutex> lock {mutex};
+	sessions.insert(c);
+	std::thread {&Server::session, this, c}.detach();
+    }
+    close(sfd);
+    unlink(path.c_str());
+
+    std::unique_lock<std::mutex> lock {mutex};
+    for (int c : sessions) shutdown(c, SHUT_RDWR);
+    idle.wait(lock, [this] { return sessions.empty(); });
+    return true;
+}
+
+void Server::worker()
+{
+    std::unique_lock<std::mutex> lock {mutex};
+    while (true) {
+	work.wait(lock, [this] { return closing || !queue.empty(); });
+	if (queue.empty()) return;
+	auto task = std::move(queue.front());
+	queue.pop_front();
+	lock.unlock();
+	task();
+	lock.lock();
+    }
+}
+
+/**
+ * Serve the connection 'c': read what requests there are, hand them
+ * to the workers, and write the answers in order when they're all
+ * done.  File descriptors are queued as they arrive, for the "-"
+ * requests to pick up.
+ */
+void Server::session(int c)
+{
+    auto submit = [this] (std::function<Result()> f) {
+		      auto task = std::make_shared<std::packaged_task<Result()>>(f);
+		      std::lock_guard<std::mutex> lock {mutex};
+		      queue.emplace_back([task] { (*task)(); });
+		      work.notify_one();
+		      return task->get_future();
+		  };
+
+    std::string buf;
+    std::deque<int> fds;
+    char data[8192];
+
+    while (true) {
+	alignas(cmsghdr) char cbuf[CMSG_SPACE(64 * sizeof(int))];
+	iovec iov {data, sizeof data};
+	msghdr msg {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof cbuf;
+
+	const ssize_t n = recvmsg(c, &msg, MSG_CMSG_CLOEXEC);
+	if (n==-1 && errno==EINTR) continue;
+	if (n <= 0) break;
+
+	for (cmsghdr* h = CMSG_FIRSTHDR(&msg); h; h = CMSG_NXTHDR(&msg, h)) {
+	    if (h->cmsg_level!=SOL_SOCKET || h->cmsg_type!=SCM_RIGHTS) continue;
+	    const size_t m = (h->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+	    for (size_t i=0; i<m; i++) {
+		int fd;
+		std::memcpy(&fd, CMSG_DATA(h) + i * sizeof fd, sizeof fd);
+		fds.push_back(fd);
+	    }
+	}
+	buf.append(data, n);
+
+	std::vector<std::future<Result>> answers;
+	std::string::size_type a = 0;
+	std::string::size_type nl;
+	while ((nl = buf.find('\n', a))!=std::string::npos) {
+	    const std::string line = buf.substr(a, nl - a);
+	    a = nl + 1;
+	    if (line!="-") {
+		answers.push_back(submit([this, line] {
+					     return timed([this, line] { return probe(line); });
+					 }));
+	    }
+	    else if (fds.empty()) {
+		answers.push_back(submit([] { Result res; res.error = EBADF; return res; }));
+	    }
+	    else {
+		const int fd = fds.front();
+		fds.pop_front();
+		answers.push_back(submit([this, fd] {
+					     return timed([this, fd] { return probe(fd); });
+					 }));
+	    }
+	}
+	buf.erase(0, a);
+
+	std::string out;
+	for (auto& f : answers) out += format(f.get());
+	if (!send_all(c, out)) break;
+    }
+
+    for (int fd : fds) close(fd);
+    std::lock_guard<std::mutex> lock {mutex};
+    close(c);
+    sessions.erase(c);
+    idle.notify_all();
+}
+
+/**
+ * Run the probe 'f' on the calling worker's Runner, so that a probe
+ * stuck on hung storage times out without taking the worker with it.
+ */
+Result Server::timed(const std::function<Result()>& f)
+{
+    thread_local Runner runner;
+    Result res;
+    if (!runner.run(options.timeout, f, res)) res.error = ETIMEDOUT;
+    return res;
+}
+
+Result Server::probe(const std::string& file)
+{
+    requests++;
+    if (anydim::Http::url(file)) return http.probe(file, options);
+
+    Result res;
+    struct stat st;
+    const bool known = stat(file.c_str(), &st)==0;
+    if (known && lru->find(file, st, res)) return res;
+
+    unsigned long gen;
+    const int wd = lru->watch(file, gen);
+    res = anydim::probe(file.c_str(), options);
+    if (wd!=-1 && known) lru->insert(file, st, res, wd, gen);
+    return res;
+}
+
+Result Server::probe(int fd)
+{
+    requests++;
+    const Result res = anydim::probe(fd, options);
+    close(fd);
+    return res;
+}
+
+void Server::put(std::ostream& os) const
+{
+    std::lock_guard<std::mutex> lock {lru->mutex};
+    os << "requests:      " << requests << '\n'
+       << "lru hits:      " << lru->hits << '\n'
+       << "lru misses:    " << lru->misses << '\n'
+       << "invalidated:   " << lru->invalidated << '\n';
+}
+
+
+bool client(const std::string& path,
+	    const std::vector<std::string>& files,
+	    const std::function<bool(const char* file,
+				     const anydim::Result& res)>& report)
+{
+    sockaddr_un sa;
+    int err = ENAMETOOLONG;
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd==-1) err = errno;
+    else if (address(path, sa)) {
+	const auto addr = reinterpret_cast<const sockaddr*>(&sa);
+	err = connect(fd, addr, sizeof sa) ? errno : 0;
+    }
+    if (err) {
+	std::cerr << path << ": " << std::strerror(err) << '\n';
+	if (fd!=-1) close(fd);
+	return false;
+    }
+
+    std::string cwd;
+    {
+	char buf[4096];
+	if (getcwd(buf, sizeof buf)) cwd = buf;
+    }
+    auto absolute = [&cwd] (const std::string& file) {
+			if (file.empty() || file[0]=='/') return file;
+			if (anydim::Http::url(file)) return file;
+			return cwd + '/' + file;
+		    };
+
+    bool ok = true;
+    std::string buf;
+    auto answer = [&] (const char* file) {
+		      std::string line;
+		      if (!getline(fd, buf, line)) return false;
+		      std::istringstream is {line};
+		      Result res;
+		      std::string mime;
+		      is >> res.error >> res.bad >> mime >> res.width >> res.height;
+		      if (!is) return false;
+		      res.mime = mime.c_str();
+		      if (!report(file, res)) ok = false;
+		      return true;
+		  };
+
+    bool sane = true;
+    if (files.empty()) {
+	sane = send_fd(fd, "-\n", 0) && answer(nullptr);
+    }
+
+    /* A chunk at a time, so neither side blocks on a full socket
+     * while the other is doing the same.
+     */
+    const size_t chunk = 64;
+    for (size_t i=0; sane && i < files.size(); i += chunk) {
+	const size_t j = std::min(i + chunk, files.size());
+	std::string out;
+	for (size_t k=i; k<j; k++) out += absolute(files[k]) + '\n';
+	sane = send_all(fd, out);
+	for (size_t k=i; sane && k<j; k++) sane = answer(files[k].c_str());
+    }
+    close(fd);
+
+    if (!sane) {
+	std::cerr << path << ": lost the connection to the server\n";
+	return false;
+    }
+    return ok;
+}
@@ -0,0 +1,102 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_SERVE_H
+#define ANYDIM_SERVE_H
+
+#include "anydim.h"
+#include "http.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <set>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * anydim as a daemon, answering requests on a Unix stream socket:
+ * for processes which need the dimensions of a file now and then, and
+ * can't afford to start anydim each time.
+ *
+ * A request is a line with a file name, or the line "-", which stands
+ * for the next file descriptor passed over the connection (with
+ * SCM_RIGHTS).  The answer is a line
+ *
+ *   error bad mime width height
+ *
+ * where 'error' is an errno value or 0, and 'bad' is 1 for files which
+ * aren't valid images.  A client may send many requests without waiting;
+ * the answers come in the same order.  File names are relative to the
+ * server's working directory.
+ *
+ * The files are probed by a pool of worker threads, shared by all
+ * connections.  The results for the most recent file names are kept
+ * in memory, and used until the file changes (is written to, has its
+ * attributes or links changed, or is moved or removed) according to
+ * inotify(7), or the name no longer leads to the same file according
+ * to stat(2).  Errors aren't kept, and neither are results for file
+ * descriptors.
+ *
+ * The constructor throws std::system_error if it can't listen on the
+ * socket.  run() serves until SIGINT, SIGTERM or SIGHUP, and then
+ * removes the socket.
+ */
+class Server {
+public:
+    Server(const std::string& path, const anydim::Options& options,
+	   unsigned workers, size_t size);
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator= (const Server&) = delete;
+
+    bool run();
+    void put(std::ostream& os) const;
+
+private:
+    struct Lru;
+
+    const std::string path;
+    const anydim::Options options;
+    const int fd;
+    anydim::Http http;
+    std::unique_ptr<Lru> lru;
+
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> queue;
+    std::set<int> sessions;
+    bool closing = false;
+    std::vector<std::thread> workers;
+
+    std::atomic<unsigned long> requests {0};
+
+    void worker();
+    void session(int fd);
+    anydim::Result timed(const std::function<anydim::Result()>& f);
+    anydim::Result probe(const std::string& file);
+    anydim::Result probe(int fd);
+};
+
+/**
+ * The client side: ask the server on 'path' for the dimensions of
+ * 'files' (or if there are none, standard input) and call 'report'
+ * with each answer.  Relative file names are made absolute first.
+ * Returns false if any of them failed, or the server couldn't be
+ * reached.
+ */
+bool client(const std::string& path,
+	    const std::vector<std::string>& files,
+	    const std::function<bool(const char* file,
+				     const anydim::Result& res)>& report);
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "archive.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using anydim::Result;
+
+
+namespace {
+
+    const size_t block = 512;
+
+    /**
+     * A stream which we read from the current position, and skip
+     * in, with lseek(2) as long as that works.
+     */
+    class Stream {
+    public:
+	explicit Stream(int fd) : fd {fd} {}
+
+	ssize_t read(uint8_t* a, size_t n);
+	int get(uint8_t* a, size_t n);
+	int skip(uint64_t n);
+
+	uint64_t offset = 0;
+
+    private:
+	const int fd;
+	bool seekable = true;
+    };
+
+    /**
+     * Read up to 'n' octets; like read(2), but never EINTR.
+     */
+    ssize_t Stream::read(uint8_t* a, size_t n)
+    {
+	while (true) {
+	    const ssize_t rc = ::read(fd, a, n);
+	    if (rc==-1 && errno==EINTR) continue;
+	    if (rc > 0) offset += rc;
+	    return rc;
+	}
+    }
+
+    /**
+     * Read exactly 'n' octets, returning 0, an errno, or EINVAL if
+     * the stream ends first.
+     */
+    int Stream::get(uint8_t* a, size_t n)
+    {
+	while (n) {
+	    const ssize_t rc = read(a, n);
+	    if (rc==-1) return errno;
+	    if (rc==0) return EINVAL;
+	    a += rc;
+	    n -= rc;
+	}
+	return 0;
+    }
+
+    /**
+     * Skip 'n' octets, returning 0, an errno, or EINVAL if the
+     * stream ends first.  Seeking past the end of a file works, so
+     * that case is caught by comparing with the file's size.
+     */
+    int Stream::skip(uint64_t n)
+    {
+	if (!n) return 0;
+	if (seekable) {
+	    const off_t pos = lseek(fd, n, SEEK_CUR);
+	    if (pos!=-1) {
+		offset += n;
+		struct stat st;
+		if (fstat(fd, &st)==-1) return errno;
+		if (S_ISREG(st.st_mode) && pos > st.st_size) return EINVAL;
+		return 0;
+	    }
+	    if (errno!=ESPIPE) return errno;
+	    seekable = false;
+	}
+
+	uint8_t buf[8192];
+	while (n) {
+	    const ssize_t rc = read(buf, std::min(n, uint64_t(sizeof buf)));
+	    if (rc==-1) return errno;
+	    if (rc==0) return EINVAL;
+	    n -= rc;
+	}
+	return 0;
+    }
+
+    /**
+     * A numeric header field: octal digits, possibly surrounded by
+     * spaces and NULs, or (the GNU way, for large numbers) big-endian
+     * binary with the top bit set.
+     */
+    bool number(const uint8_t* a, size_t n, uint64_t& val)
+    {
+	val = 0;
+	if (*a & 0x80) {
+	    val = *a & 0x3f;
+	    for (size_t i=1; i<n; i++) val = val << 8 | a[i];
+	    return true;
+	}
+	const uint8_t* const b = a + n;
+	while (a!=b && *a==' ') a++;
+	const uint8_t* const digits = a;
+	while (a!=b && *a>='0' && *a<='7') val = val << 3 | (*a++ - '0');
+	return a!=digits && (a==b || !*a || *a==' ');
+    }
+
+    std::string field(const uint8_t* a, size_t n)
+    {
+	const uint8_t* const nul = std::find(a, a + n, 0);
+	return {a, nul};
+    }
+
+    bool checksum(const uint8_t* h)
+    {
+	uint64_t sum;
+	if (!number(h + 148, 8, sum)) return false;
+	unsigned n = 0;
+	for (size_t i=0; i<block; i++) {
+	    n += (i >= 148 && i < 156) ? ' ' : h[i];
+	}
+	return n==sum;
+    }
+
+    /**
+     * The "path" record from a pax extended header, if there is one.
+     * Records are "<length> <key>=<value>\n".
+     */
+    std::string pax_path(const std::string& s)
+    {
+	std::string::size_type a = 0;
+	while (a < s.size()) {
+	    const auto sp = s.find(' ', a);
+	    if (sp==std::string::npos) break;
+	    const unsigned long len = std::strtoul(s.c_str() + a, nullptr, 10);
+	    if (!len || a + len > s.size()) break;
+	    const std::string rec = s.substr(sp + 1, a + len - sp - 2);
+	    if (rec.compare(0, 5, "path=")==0) return rec.substr(5);
+	    a += len;
+	}
+	return "";
+    }
+
+    /**
+     * Probe the member of 'size' octets at the current position, and
+     * skip what's left of it, up to the next header.
+     */
+    int probe(Stream& s, uint64_t size, const anydim::Options& options,
+	      Result& res)
+    {
+	anydim::AnyDim dim {options.use_exif, options.max_octets, options.memo};
+	uint8_t buf[4096];
+	uint64_t pos = 0;
+
+	while (dim.undecided() && pos < size) {
+	    const size_t want = dim.want();
+	    size_t n = want? std::min(want, sizeof buf): sizeof buf;
+	    n = std::min(uint64_t(n), size - pos);
+	    const ssize_t rc = s.read(buf, n);
+	    if (rc==-1) return errno;
+	    if (rc==0) return EINVAL;
+	    res.tally(s.offset - rc, rc);
+	    dim.feed(buf, buf + rc);
+	    pos += rc;
+
+	    const size_t skip = std::min(uint64_t(dim.skippable()), size - pos);
+	    if (skip) {
+		if (const int err = s.skip(skip)) return err;
+		dim.skip(skip);
+		pos += skip;
+	    }
+	}
+	if (dim.undecided()) dim.eof();
+	res.decided(dim);
+
+	const uint64_t padded = (size + block - 1) / block * block;
+	return s.skip(padded - pos);
+    }
+
+    /**
+     * Read the data of a member which holds a name (or pax records),
+     * up to a sane size.
+     */
+    int text(Stream& s, uint64_t size, std::string& str)
+    {
+	if (size > 1 << 20) return EINVAL;
+	const uint64_t padded = (size + block - 1) / block * block;
+	std::vector<uint8_t> v(padded);
+	if (const int err = s.get(v.data(), v.size())) return err;
+	str.assign(v.begin(), v.begin() + size);
+	return 0;
+    }
+}
+
+
+int anydim::probe_tar(int fd, const Options& options, const Member& member)
+{
+    Stream s {fd};
+    uint8_t h[block];
+    std::string longname;
+    unsigned zeros = 0;
+
+    while (zeros < 2) {
+	const uint64_t start = s.offset;
+	const ssize_t n = s.read(h, block);
+	if (n==0 && start > 0) return 0;
+	if (n==-1) return errno;
+	if (size_t(n) < block) {
+	    if (const int err = s.get(h + n, block - n)) return err;
+	}
+
+	if (std::all_of(h, h + block, [] (uint8_t c) { return !c; })) {
+	    zeros++;
+	    continue;
+	}
+	zeros = 0;
+
+	uint64_t size;
+	if (!checksum(h) || !number(h + 124, 12, size)) return EINVAL;
+	const uint8_t type = h[156];
+
+	std::string name = field(h, 100);
+	if (!std::memcmp(h + 257, "ustar", 5) && h[345]) {
+	    name = field(h + 345, 155) + '/' + name;
+	}
+
+	int err = 0;
+	std::string str;
+	switch (type) {
+	case 'L':
+	    err = text(s, size, str);
+	    if (err) return err;
+	    longname = str.c_str();
+	    continue;
+	case 'x':
+	    err = text(s, size, str);
+	    longname = pax_path(str);
+	    if (err) return err;
+	    continue;
+	case '0':
+	case '\0':
+	case '7':
+	    if (!longname.empty()) name = longname;
+	    longname.clear();
+	    {
+		Result res;
+		err = probe(s, size, options, res);
+		if (err && err!=EINVAL) return err;
+		if (err) res.error = err;
+		member(name, res);
+		if (err) return err;
+	    }
+	    break;
+	default:
+	    longname.clear();
+	    err = s.skip((size + block - 1) / block * block);
+	    break;
+	}
+	if (err) return err;
+    }
+    return 0;
+}
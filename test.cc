@@ -0,0 +1,241 @@
+#include <orchis.h>
+#include <iostream>
+#include <cstring>
+namespace capi { void incremental(orchis::TC); }
+namespace capi { void fd(orchis::TC); }
+namespace capi { void bad(orchis::TC); }
+namespace capi { void buffer(orchis::TC); }
+namespace capi { void undecided(orchis::TC); }
+namespace compressed { void xz_dictionary(orchis::TC); }
+namespace compressed { void gz(orchis::TC); }
+namespace compressed { void xz(orchis::TC); }
+namespace compressed { void early(orchis::TC); }
+namespace compressed { void limit(orchis::TC); }
+namespace compressed { void nested(orchis::TC); }
+namespace compressed { void corrupt(orchis::TC); }
+namespace png { void test(orchis::TC); }
+namespace pnm { void pbm(orchis::TC); }
+namespace pnm { void pgm(orchis::TC); }
+namespace pnm { void ppm(orchis::TC); }
+namespace pnm { void ppm_raw(orchis::TC); }
+namespace jfif { void progressive(orchis::TC); }
+namespace jfif { void gray(orchis::TC); }
+namespace jfif { void plain(orchis::TC); }
+namespace plan { void within_limit(orchis::TC); }
+namespace plan { void sof_not_skipped(orchis::TC); }
+namespace plan { void limit(orchis::TC); }
+namespace plan { void comment(orchis::TC); }
+namespace plan { void png_want(orchis::TC); }
+namespace plan { void jpeg_skip(orchis::TC); }
+namespace probe { void png(orchis::TC); }
+namespace probe { void ppm(orchis::TC); }
+namespace probe { void jpeg(orchis::TC); }
+namespace probe { void tally(orchis::TC); }
+namespace probe { void garbage(orchis::TC); }
+namespace probe { void missing(orchis::TC); }
+namespace reset { void test(orchis::TC); }
+namespace garbage { void test(orchis::TC); }
+namespace garbage { void empty(orchis::TC); }
+namespace jfif { namespace bad { void empty(orchis::TC); } }
+namespace jfif { namespace bad { void start(orchis::TC); } }
+namespace jfif { namespace bad { void length(orchis::TC); } }
+namespace jfif { namespace bad { namespace truncated { void a(orchis::TC); } } }
+namespace jfif { namespace bad { namespace truncated { void b(orchis::TC); } } }
+namespace jfif { namespace bad { namespace truncated { void c(orchis::TC); } } }
+namespace jfif { namespace bad { namespace truncated { void d(orchis::TC); } } }
+namespace jfif { namespace bad { namespace truncated { void e(orchis::TC); } } }
+namespace jfif { namespace good { void standalone(orchis::TC); } }
+namespace jfif { namespace good { void trailing_eoi(orchis::TC); } }
+namespace jfif { namespace good { void empty_segment(orchis::TC); } }
+namespace jfif { namespace good { void ff00(orchis::TC); } }
+namespace jfif { namespace good { void simple(orchis::TC); } }
+namespace jfif { namespace good { void padding(orchis::TC); } }
+namespace jfif { namespace skip { void nothing(orchis::TC); } }
+namespace jfif { namespace skip { void partial(orchis::TC); } }
+namespace jfif { namespace skip { void segment(orchis::TC); } }
+namespace tiff { namespace intel { void undefinedv(orchis::TC); } }
+namespace tiff { namespace intel { void ratv(orchis::TC); } }
+namespace tiff { namespace intel { void ascii(orchis::TC); } }
+namespace tiff { namespace intel { void bytev(orchis::TC); } }
+namespace tiff { namespace intel { void longv(orchis::TC); } }
+namespace tiff { namespace intel { void shortv(orchis::TC); } }
+namespace tiff { namespace intel { namespace failure { void type(orchis::TC); } } }
+namespace tiff { namespace intel { namespace failure { void not_found(orchis::TC); } } }
+namespace tiff { namespace intel { namespace optional { void byte_array(orchis::TC); } } }
+namespace tiff { namespace intel { namespace optional { void one_long(orchis::TC); } } }
+namespace tiff { namespace broken { void empty(orchis::TC); } }
+namespace tiff { namespace broken { void error(orchis::TC); } }
+namespace tiff { namespace broken { void segfault(orchis::TC); } }
+namespace tiff { namespace motorola { void undefinedv(orchis::TC); } }
+namespace tiff { namespace motorola { void ratv(orchis::TC); } }
+namespace tiff { namespace motorola { void ascii(orchis::TC); } }
+namespace tiff { namespace motorola { void bytev(orchis::TC); } }
+namespace tiff { namespace motorola { void longv(orchis::TC); } }
+namespace tiff { namespace motorola { void shortv(orchis::TC); } }
+namespace tiff { namespace motorola { namespace failure { void type(orchis::TC); } } }
+namespace tiff { namespace motorola { namespace failure { void not_found(orchis::TC); } } }
+namespace tiff { namespace motorola { namespace optional { void byte_array(orchis::TC); } } }
+namespace tiff { namespace motorola { namespace optional { void one_long(orchis::TC); } } }
+namespace tar { void file(orchis::TC); }
+namespace tar { void pipe(orchis::TC); }
+namespace tar { void garbage(orchis::TC); }
+namespace tar { void truncated(orchis::TC); }
+namespace zip { void pipe(orchis::TC); }
+namespace zip { void test(orchis::TC); }
+namespace zip { void garbage(orchis::TC); }
+namespace http { void skip(orchis::TC); }
+namespace http { void https(orchis::TC); }
+namespace http { void whole(orchis::TC); }
+namespace http { void ranges(orchis::TC); }
+namespace http { void control(orchis::TC); }
+namespace http { void missing(orchis::TC); }
+namespace carve { void test(orchis::TC); }
+namespace carve { void range(orchis::TC); }
+namespace carve { void nothing(orchis::TC); }
+namespace cache { void exif(orchis::TC); }
+namespace cache { void probe(orchis::TC); }
+namespace cache { void xattr(orchis::TC); }
+namespace cache { void shared(orchis::TC); }
+namespace cache { void simple(orchis::TC); }
+namespace cache { void compact(orchis::TC); }
+namespace cache { void garbage(orchis::TC); }
+namespace cache { void limited(orchis::TC); }
+namespace cache { void uncached(orchis::TC); }
+namespace memo { void bad(orchis::TC); }
+namespace memo { void pnm(orchis::TC); }
+namespace memo { void jpeg(orchis::TC); }
+namespace memo { void unused(orchis::TC); }
+namespace chunks { void no_keyword(orchis::TC); }
+namespace chunks { void iend(orchis::TC); }
+namespace chunks { void simple(orchis::TC); }
+namespace chunks { void corrupt(orchis::TC); }
+namespace chunks { void not_png(orchis::TC); }
+namespace chunks { void truncated(orchis::TC); }
+namespace thumb { void orientation(orchis::TC); }
+namespace thumb { void unknown_mime(orchis::TC); }
+namespace thumb { void uri(orchis::TC); }
+namespace thumb { void name(orchis::TC); }
+namespace thumb { void found(orchis::TC); }
+namespace thumb { void stale(orchis::TC); }
+namespace thumb { void missing(orchis::TC); }
+int main(int argc, char** argv) {
+ int fail=0, err=0;
+ if(argc<3 || std::strstr("capi::incremental", argv[2])) try { capi::incremental(orchis::TC{}); std::cout << "PASS capi::incremental\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL capi::incremental: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR capi::incremental\n"; err++; }
+ if(argc<3 || std::strstr("capi::fd", argv[2])) try { capi::fd(orchis::TC{}); std::cout << "PASS capi::fd\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL capi::fd: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR capi::fd\n"; err++; }
+ if(argc<3 || std::strstr("capi::bad", argv[2])) try { capi::bad(orchis::TC{}); std::cout << "PASS capi::bad\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL capi::bad: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR capi::bad\n"; err++; }
+ if(argc<3 || std::strstr("capi::buffer", argv[2])) try { capi::buffer(orchis::TC{}); std::cout << "PASS capi::buffer\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL capi::buffer: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR capi::buffer\n"; err++; }
+ if(argc<3 || std::strstr("capi::undecided", argv[2])) try { capi::undecided(orchis::TC{}); std::cout << "PASS capi::undecided\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL capi::undecided: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR capi::undecided\n"; err++; }
+ if(argc<3 || std::strstr("compressed::xz_dictionary", argv[2])) try { compressed::xz_dictionary(orchis::TC{}); std::cout << "PASS compressed::xz_dictionary\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::xz_dictionary: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::xz_dictionary\n"; err++; }
+ if(argc<3 || std::strstr("compressed::gz", argv[2])) try { compressed::gz(orchis::TC{}); std::cout << "PASS compressed::gz\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::gz: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::gz\n"; err++; }
+ if(argc<3 || std::strstr("compressed::xz", argv[2])) try { compressed::xz(orchis::TC{}); std::cout << "PASS compressed::xz\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::xz: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::xz\n"; err++; }
+ if(argc<3 || std::strstr("compressed::early", argv[2])) try { compressed::early(orchis::TC{}); std::cout << "PASS compressed::early\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::early: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::early\n"; err++; }
+ if(argc<3 || std::strstr("compressed::limit", argv[2])) try { compressed::limit(orchis::TC{}); std::cout << "PASS compressed::limit\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::limit: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::limit\n"; err++; }
+ if(argc<3 || std::strstr("compressed::nested", argv[2])) try { compressed::nested(orchis::TC{}); std::cout << "PASS compressed::nested\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::nested: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::nested\n"; err++; }
+ if(argc<3 || std::strstr("compressed::corrupt", argv[2])) try { compressed::corrupt(orchis::TC{}); std::cout << "PASS compressed::corrupt\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL compressed::corrupt: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR compressed::corrupt\n"; err++; }
+ if(argc<3 || std::strstr("png::test", argv[2])) try { png::test(orchis::TC{}); std::cout << "PASS png::test\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL png::test: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR png::test\n"; err++; }
+ if(argc<3 || std::strstr("pnm::pbm", argv[2])) try { pnm::pbm(orchis::TC{}); std::cout << "PASS pnm::pbm\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL pnm::pbm: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR pnm::pbm\n"; err++; }
+ if(argc<3 || std::strstr("pnm::pgm", argv[2])) try { pnm::pgm(orchis::TC{}); std::cout << "PASS pnm::pgm\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL pnm::pgm: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR pnm::pgm\n"; err++; }
+ if(argc<3 || std::strstr("pnm::ppm", argv[2])) try { pnm::ppm(orchis::TC{}); std::cout << "PASS pnm::ppm\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL pnm::ppm: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR pnm::ppm\n"; err++; }
+ if(argc<3 || std::strstr("pnm::ppm_raw", argv[2])) try { pnm::ppm_raw(orchis::TC{}); std::cout << "PASS pnm::ppm_raw\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL pnm::ppm_raw: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR pnm::ppm_raw\n"; err++; }
+ if(argc<3 || std::strstr("jfif::progressive", argv[2])) try { jfif::progressive(orchis::TC{}); std::cout << "PASS jfif::progressive\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::progressive: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::progressive\n"; err++; }
+ if(argc<3 || std::strstr("jfif::gray", argv[2])) try { jfif::gray(orchis::TC{}); std::cout << "PASS jfif::gray\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::gray: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::gray\n"; err++; }
+ if(argc<3 || std::strstr("jfif::plain", argv[2])) try { jfif::plain(orchis::TC{}); std::cout << "PASS jfif::plain\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::plain: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::plain\n"; err++; }
+ if(argc<3 || std::strstr("plan::within_limit", argv[2])) try { plan::within_limit(orchis::TC{}); std::cout << "PASS plan::within_limit\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL plan::within_limit: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR plan::within_limit\n"; err++; }
+ if(argc<3 || std::strstr("plan::sof_not_skipped", argv[2])) try { plan::sof_not_skipped(orchis::TC{}); std::cout << "PASS plan::sof_not_skipped\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL plan::sof_not_skipped: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR plan::sof_not_skipped\n"; err++; }
+ if(argc<3 || std::strstr("plan::limit", argv[2])) try { plan::limit(orchis::TC{}); std::cout << "PASS plan::limit\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL plan::limit: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR plan::limit\n"; err++; }
+ if(argc<3 || std::strstr("plan::comment", argv[2])) try { plan::comment(orchis::TC{}); std::cout << "PASS plan::comment\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL plan::comment: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR plan::comment\n"; err++; }
+ if(argc<3 || std::strstr("plan::png_want", argv[2])) try { plan::png_want(orchis::TC{}); std::cout << "PASS plan::png_want\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL plan::png_want: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR plan::png_want\n"; err++; }
+ if(argc<3 || std::strstr("plan::jpeg_skip", argv[2])) try { plan::jpeg_skip(orchis::TC{}); std::cout << "PASS plan::jpeg_skip\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL plan::jpeg_skip: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR plan::jpeg_skip\n"; err++; }
+ if(argc<3 || std::strstr("probe::png", argv[2])) try { probe::png(orchis::TC{}); std::cout << "PASS probe::png\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL probe::png: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR probe::png\n"; err++; }
+ if(argc<3 || std::strstr("probe::ppm", argv[2])) try { probe::ppm(orchis::TC{}); std::cout << "PASS probe::ppm\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL probe::ppm: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR probe::ppm\n"; err++; }
+ if(argc<3 || std::strstr("probe::jpeg", argv[2])) try { probe::jpeg(orchis::TC{}); std::cout << "PASS probe::jpeg\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL probe::jpeg: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR probe::jpeg\n"; err++; }
+ if(argc<3 || std::strstr("probe::tally", argv[2])) try { probe::tally(orchis::TC{}); std::cout << "PASS probe::tally\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL probe::tally: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR probe::tally\n"; err++; }
+ if(argc<3 || std::strstr("probe::garbage", argv[2])) try { probe::garbage(orchis::TC{}); std::cout << "PASS probe::garbage\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL probe::garbage: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR probe::garbage\n"; err++; }
+ if(argc<3 || std::strstr("probe::missing", argv[2])) try { probe::missing(orchis::TC{}); std::cout << "PASS probe::missing\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL probe::missing: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR probe::missing\n"; err++; }
+ if(argc<3 || std::strstr("reset::test", argv[2])) try { reset::test(orchis::TC{}); std::cout << "PASS reset::test\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL reset::test: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR reset::test\n"; err++; }
+ if(argc<3 || std::strstr("garbage::test", argv[2])) try { garbage::test(orchis::TC{}); std::cout << "PASS garbage::test\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL garbage::test: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR garbage::test\n"; err++; }
+ if(argc<3 || std::strstr("garbage::empty", argv[2])) try { garbage::empty(orchis::TC{}); std::cout << "PASS garbage::empty\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL garbage::empty: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR garbage::empty\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::empty", argv[2])) try { jfif::bad::empty(orchis::TC{}); std::cout << "PASS jfif::bad::empty\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::empty: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::empty\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::start", argv[2])) try { jfif::bad::start(orchis::TC{}); std::cout << "PASS jfif::bad::start\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::start: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::start\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::length", argv[2])) try { jfif::bad::length(orchis::TC{}); std::cout << "PASS jfif::bad::length\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::length: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::length\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::truncated::a", argv[2])) try { jfif::bad::truncated::a(orchis::TC{}); std::cout << "PASS jfif::bad::truncated::a\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::truncated::a: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::truncated::a\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::truncated::b", argv[2])) try { jfif::bad::truncated::b(orchis::TC{}); std::cout << "PASS jfif::bad::truncated::b\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::truncated::b: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::truncated::b\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::truncated::c", argv[2])) try { jfif::bad::truncated::c(orchis::TC{}); std::cout << "PASS jfif::bad::truncated::c\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::truncated::c: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::truncated::c\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::truncated::d", argv[2])) try { jfif::bad::truncated::d(orchis::TC{}); std::cout << "PASS jfif::bad::truncated::d\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::truncated::d: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::truncated::d\n"; err++; }
+ if(argc<3 || std::strstr("jfif::bad::truncated::e", argv[2])) try { jfif::bad::truncated::e(orchis::TC{}); std::cout << "PASS jfif::bad::truncated::e\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::bad::truncated::e: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::bad::truncated::e\n"; err++; }
+ if(argc<3 || std::strstr("jfif::good::standalone", argv[2])) try { jfif::good::standalone(orchis::TC{}); std::cout << "PASS jfif::good::standalone\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::good::standalone: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::good::standalone\n"; err++; }
+ if(argc<3 || std::strstr("jfif::good::trailing_eoi", argv[2])) try { jfif::good::trailing_eoi(orchis::TC{}); std::cout << "PASS jfif::good::trailing_eoi\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::good::trailing_eoi: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::good::trailing_eoi\n"; err++; }
+ if(argc<3 || std::strstr("jfif::good::empty_segment", argv[2])) try { jfif::good::empty_segment(orchis::TC{}); std::cout << "PASS jfif::good::empty_segment\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::good::empty_segment: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::good::empty_segment\n"; err++; }
+ if(argc<3 || std::strstr("jfif::good::ff00", argv[2])) try { jfif::good::ff00(orchis::TC{}); std::cout << "PASS jfif::good::ff00\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::good::ff00: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::good::ff00\n"; err++; }
+ if(argc<3 || std::strstr("jfif::good::simple", argv[2])) try { jfif::good::simple(orchis::TC{}); std::cout << "PASS jfif::good::simple\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::good::simple: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::good::simple\n"; err++; }
+ if(argc<3 || std::strstr("jfif::good::padding", argv[2])) try { jfif::good::padding(orchis::TC{}); std::cout << "PASS jfif::good::padding\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::good::padding: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::good::padding\n"; err++; }
+ if(argc<3 || std::strstr("jfif::skip::nothing", argv[2])) try { jfif::skip::nothing(orchis::TC{}); std::cout << "PASS jfif::skip::nothing\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::skip::nothing: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::skip::nothing\n"; err++; }
+ if(argc<3 || std::strstr("jfif::skip::partial", argv[2])) try { jfif::skip::partial(orchis::TC{}); std::cout << "PASS jfif::skip::partial\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::skip::partial: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::skip::partial\n"; err++; }
+ if(argc<3 || std::strstr("jfif::skip::segment", argv[2])) try { jfif::skip::segment(orchis::TC{}); std::cout << "PASS jfif::skip::segment\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL jfif::skip::segment: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR jfif::skip::segment\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::undefinedv", argv[2])) try { tiff::intel::undefinedv(orchis::TC{}); std::cout << "PASS tiff::intel::undefinedv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::undefinedv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::undefinedv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::ratv", argv[2])) try { tiff::intel::ratv(orchis::TC{}); std::cout << "PASS tiff::intel::ratv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::ratv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::ratv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::ascii", argv[2])) try { tiff::intel::ascii(orchis::TC{}); std::cout << "PASS tiff::intel::ascii\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::ascii: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::ascii\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::bytev", argv[2])) try { tiff::intel::bytev(orchis::TC{}); std::cout << "PASS tiff::intel::bytev\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::bytev: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::bytev\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::longv", argv[2])) try { tiff::intel::longv(orchis::TC{}); std::cout << "PASS tiff::intel::longv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::longv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::longv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::shortv", argv[2])) try { tiff::intel::shortv(orchis::TC{}); std::cout << "PASS tiff::intel::shortv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::shortv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::shortv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::failure::type", argv[2])) try { tiff::intel::failure::type(orchis::TC{}); std::cout << "PASS tiff::intel::failure::type\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::failure::type: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::failure::type\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::failure::not_found", argv[2])) try { tiff::intel::failure::not_found(orchis::TC{}); std::cout << "PASS tiff::intel::failure::not_found\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::failure::not_found: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::failure::not_found\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::optional::byte_array", argv[2])) try { tiff::intel::optional::byte_array(orchis::TC{}); std::cout << "PASS tiff::intel::optional::byte_array\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::optional::byte_array: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::optional::byte_array\n"; err++; }
+ if(argc<3 || std::strstr("tiff::intel::optional::one_long", argv[2])) try { tiff::intel::optional::one_long(orchis::TC{}); std::cout << "PASS tiff::intel::optional::one_long\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::intel::optional::one_long: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::intel::optional::one_long\n"; err++; }
+ if(argc<3 || std::strstr("tiff::broken::empty", argv[2])) try { tiff::broken::empty(orchis::TC{}); std::cout << "PASS tiff::broken::empty\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::broken::empty: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::broken::empty\n"; err++; }
+ if(argc<3 || std::strstr("tiff::broken::error", argv[2])) try { tiff::broken::error(orchis::TC{}); std::cout << "PASS tiff::broken::error\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::broken::error: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::broken::error\n"; err++; }
+ if(argc<3 || std::strstr("tiff::broken::segfault", argv[2])) try { tiff::broken::segfault(orchis::TC{}); std::cout << "PASS tiff::broken::segfault\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::broken::segfault: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::broken::segfault\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::undefinedv", argv[2])) try { tiff::motorola::undefinedv(orchis::TC{}); std::cout << "PASS tiff::motorola::undefinedv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::undefinedv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::undefinedv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::ratv", argv[2])) try { tiff::motorola::ratv(orchis::TC{}); std::cout << "PASS tiff::motorola::ratv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::ratv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::ratv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::ascii", argv[2])) try { tiff::motorola::ascii(orchis::TC{}); std::cout << "PASS tiff::motorola::ascii\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::ascii: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::ascii\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::bytev", argv[2])) try { tiff::motorola::bytev(orchis::TC{}); std::cout << "PASS tiff::motorola::bytev\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::bytev: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::bytev\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::longv", argv[2])) try { tiff::motorola::longv(orchis::TC{}); std::cout << "PASS tiff::motorola::longv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::longv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::longv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::shortv", argv[2])) try { tiff::motorola::shortv(orchis::TC{}); std::cout << "PASS tiff::motorola::shortv\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::shortv: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::shortv\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::failure::type", argv[2])) try { tiff::motorola::failure::type(orchis::TC{}); std::cout << "PASS tiff::motorola::failure::type\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::failure::type: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::failure::type\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::failure::not_found", argv[2])) try { tiff::motorola::failure::not_found(orchis::TC{}); std::cout << "PASS tiff::motorola::failure::not_found\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::failure::not_found: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::failure::not_found\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::optional::byte_array", argv[2])) try { tiff::motorola::optional::byte_array(orchis::TC{}); std::cout << "PASS tiff::motorola::optional::byte_array\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::optional::byte_array: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::optional::byte_array\n"; err++; }
+ if(argc<3 || std::strstr("tiff::motorola::optional::one_long", argv[2])) try { tiff::motorola::optional::one_long(orchis::TC{}); std::cout << "PASS tiff::motorola::optional::one_long\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tiff::motorola::optional::one_long: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tiff::motorola::optional::one_long\n"; err++; }
+ if(argc<3 || std::strstr("tar::file", argv[2])) try { tar::file(orchis::TC{}); std::cout << "PASS tar::file\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tar::file: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tar::file\n"; err++; }
+ if(argc<3 || std::strstr("tar::pipe", argv[2])) try { tar::pipe(orchis::TC{}); std::cout << "PASS tar::pipe\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tar::pipe: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tar::pipe\n"; err++; }
+ if(argc<3 || std::strstr("tar::garbage", argv[2])) try { tar::garbage(orchis::TC{}); std::cout << "PASS tar::garbage\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tar::garbage: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tar::garbage\n"; err++; }
+ if(argc<3 || std::strstr("tar::truncated", argv[2])) try { tar::truncated(orchis::TC{}); std::cout << "PASS tar::truncated\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL tar::truncated: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR tar::truncated\n"; err++; }
+ if(argc<3 || std::strstr("zip::pipe", argv[2])) try { zip::pipe(orchis::TC{}); std::cout << "PASS zip::pipe\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL zip::pipe: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR zip::pipe\n"; err++; }
+ if(argc<3 || std::strstr("zip::test", argv[2])) try { zip::test(orchis::TC{}); std::cout << "PASS zip::test\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL zip::test: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR zip::test\n"; err++; }
+ if(argc<3 || std::strstr("zip::garbage", argv[2])) try { zip::garbage(orchis::TC{}); std::cout << "PASS zip::garbage\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL zip::garbage: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR zip::garbage\n"; err++; }
+ if(argc<3 || std::strstr("http::skip", argv[2])) try { http::skip(orchis::TC{}); std::cout << "PASS http::skip\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL http::skip: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR http::skip\n"; err++; }
+ if(argc<3 || std::strstr("http::https", argv[2])) try { http::https(orchis::TC{}); std::cout << "PASS http::https\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL http::https: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR http::https\n"; err++; }
+ if(argc<3 || std::strstr("http::whole", argv[2])) try { http::whole(orchis::TC{}); std::cout << "PASS http::whole\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL http::whole: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR http::whole\n"; err++; }
+ if(argc<3 || std::strstr("http::ranges", argv[2])) try { http::ranges(orchis::TC{}); std::cout << "PASS http::ranges\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL http::ranges: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR http::ranges\n"; err++; }
+ if(argc<3 || std::strstr("http::control", argv[2])) try { http::control(orchis::TC{}); std::cout << "PASS http::control\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL http::control: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR http::control\n"; err++; }
+ if(argc<3 || std::strstr("http::missing", argv[2])) try { http::missing(orchis::TC{}); std::cout << "PASS http::missing\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL http::missing: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR http::missing\n"; err++; }
+ if(argc<3 || std::strstr("carve::test", argv[2])) try { carve::test(orchis::TC{}); std::cout << "PASS carve::test\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL carve::test: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR carve::test\n"; err++; }
+ if(argc<3 || std::strstr("carve::range", argv[2])) try { carve::range(orchis::TC{}); std::cout << "PASS carve::range\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL carve::range: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR carve::range\n"; err++; }
+ if(argc<3 || std::strstr("carve::nothing", argv[2])) try { carve::nothing(orchis::TC{}); std::cout << "PASS carve::nothing\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL carve::nothing: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR carve::nothing\n"; err++; }
+ if(argc<3 || std::strstr("cache::exif", argv[2])) try { cache::exif(orchis::TC{}); std::cout << "PASS cache::exif\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::exif: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::exif\n"; err++; }
+ if(argc<3 || std::strstr("cache::probe", argv[2])) try { cache::probe(orchis::TC{}); std::cout << "PASS cache::probe\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::probe: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::probe\n"; err++; }
+ if(argc<3 || std::strstr("cache::xattr", argv[2])) try { cache::xattr(orchis::TC{}); std::cout << "PASS cache::xattr\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::xattr: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::xattr\n"; err++; }
+ if(argc<3 || std::strstr("cache::shared", argv[2])) try { cache::shared(orchis::TC{}); std::cout << "PASS cache::shared\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::shared: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::shared\n"; err++; }
+ if(argc<3 || std::strstr("cache::simple", argv[2])) try { cache::simple(orchis::TC{}); std::cout << "PASS cache::simple\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::simple: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::simple\n"; err++; }
+ if(argc<3 || std::strstr("cache::compact", argv[2])) try { cache::compact(orchis::TC{}); std::cout << "PASS cache::compact\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::compact: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::compact\n"; err++; }
+ if(argc<3 || std::strstr("cache::garbage", argv[2])) try { cache::garbage(orchis::TC{}); std::cout << "PASS cache::garbage\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::garbage: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::garbage\n"; err++; }
+ if(argc<3 || std::strstr("cache::limited", argv[2])) try { cache::limited(orchis::TC{}); std::cout << "PASS cache::limited\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::limited: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::limited\n"; err++; }
+ if(argc<3 || std::strstr("cache::uncached", argv[2])) try { cache::uncached(orchis::TC{}); std::cout << "PASS cache::uncached\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL cache::uncached: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR cache::uncached\n"; err++; }
+ if(argc<3 || std::strstr("memo::bad", argv[2])) try { memo::bad(orchis::TC{}); std::cout << "PASS memo::bad\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL memo::bad: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR memo::bad\n"; err++; }
+ if(argc<3 || std::strstr("memo::pnm", argv[2])) try { memo::pnm(orchis::TC{}); std::cout << "PASS memo::pnm\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL memo::pnm: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR memo::pnm\n"; err++; }
+ if(argc<3 || std::strstr("memo::jpeg", argv[2])) try { memo::jpeg(orchis::TC{}); std::cout << "PASS memo::jpeg\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL memo::jpeg: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR memo::jpeg\n"; err++; }
+ if(argc<3 || std::strstr("memo::unused", argv[2])) try { memo::unused(orchis::TC{}); std::cout << "PASS memo::unused\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL memo::unused: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR memo::unused\n"; err++; }
+ if(argc<3 || std::strstr("chunks::no_keyword", argv[2])) try { chunks::no_keyword(orchis::TC{}); std::cout << "PASS chunks::no_keyword\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL chunks::no_keyword: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR chunks::no_keyword\n"; err++; }
+ if(argc<3 || std::strstr("chunks::iend", argv[2])) try { chunks::iend(orchis::TC{}); std::cout << "PASS chunks::iend\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL chunks::iend: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR chunks::iend\n"; err++; }
+ if(argc<3 || std::strstr("chunks::simple", argv[2])) try { chunks::simple(orchis::TC{}); std::cout << "PASS chunks::simple\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL chunks::simple: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR chunks::simple\n"; err++; }
+ if(argc<3 || std::strstr("chunks::corrupt", argv[2])) try { chunks::corrupt(orchis::TC{}); std::cout << "PASS chunks::corrupt\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL chunks::corrupt: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR chunks::corrupt\n"; err++; }
+ if(argc<3 || std::strstr("chunks::not_png", argv[2])) try { chunks::not_png(orchis::TC{}); std::cout << "PASS chunks::not_png\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL chunks::not_png: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR chunks::not_png\n"; err++; }
+ if(argc<3 || std::strstr("chunks::truncated", argv[2])) try { chunks::truncated(orchis::TC{}); std::cout << "PASS chunks::truncated\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL chunks::truncated: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR chunks::truncated\n"; err++; }
+ if(argc<3 || std::strstr("thumb::orientation", argv[2])) try { thumb::orientation(orchis::TC{}); std::cout << "PASS thumb::orientation\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::orientation: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::orientation\n"; err++; }
+ if(argc<3 || std::strstr("thumb::unknown_mime", argv[2])) try { thumb::unknown_mime(orchis::TC{}); std::cout << "PASS thumb::unknown_mime\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::unknown_mime: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::unknown_mime\n"; err++; }
+ if(argc<3 || std::strstr("thumb::uri", argv[2])) try { thumb::uri(orchis::TC{}); std::cout << "PASS thumb::uri\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::uri: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::uri\n"; err++; }
+ if(argc<3 || std::strstr("thumb::name", argv[2])) try { thumb::name(orchis::TC{}); std::cout << "PASS thumb::name\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::name: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::name\n"; err++; }
+ if(argc<3 || std::strstr("thumb::found", argv[2])) try { thumb::found(orchis::TC{}); std::cout << "PASS thumb::found\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::found: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::found\n"; err++; }
+ if(argc<3 || std::strstr("thumb::stale", argv[2])) try { thumb::stale(orchis::TC{}); std::cout << "PASS thumb::stale\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::stale: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::stale\n"; err++; }
+ if(argc<3 || std::strstr("thumb::missing", argv[2])) try { thumb::missing(orchis::TC{}); std::cout << "PASS thumb::missing\n"; } catch(const orchis::Failure& e) { std::cout << "FAIL thumb::missing: " << e.msg << "\n"; fail++; } catch(...) { std::cout << "ERROR thumb::missing\n"; err++; }
+ std::cout << fail << " failed, " << err << " errors\n"; return fail!=0;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume test/anydim.png exists, and is 48 × 21 pixels.
+ */
+#include <cache.h>
+
+#include <string>
+#include <fstream>
+
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/xattr.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+using anydim::Cache;
+
+namespace cache {
+
+    /**
+     * A temporary, empty file, removed at the end of the test.
+     */
+    struct Tmp {
+	Tmp()
+	    : path {"/tmp/anydim.XXXXXX"}
+	{
+	    close(mkstemp(&path[0]));
+	}
+	~Tmp() { unlink(path.c_str()); }
+	string path;
+    };
+
+    const Cache::Key key {1, 2, 3, 1000000000};
+
+    anydim::Result result(unsigned width, unsigned height)
+    {
+	anydim::Result res;
+	res.mime = "image/png";
+	res.width = width;
+	res.height = height;
+	return res;
+    }
+
+    void simple(TC)
+    {
+	Tmp tmp;
+	Cache cache {tmp.path};
+	anydim::Result res;
+	orchis::assert_false(cache.find(key, res));
+	cache.insert(key, result(48, 21));
+	orchis::assert_true(cache.find(key, res));
+	orchis::assert_eq(res.mime, string("image/png"));
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_eq(res.height, 21u);
+
+	for (Cache::Key k : {Cache::Key {2, 2, 3, 1000000000},
+			     Cache::Key {1, 3, 3, 1000000000},
+			     Cache::Key {1, 2, 4, 1000000000},
+			     Cache::Key {1, 2, 3, 1000000001}}) {
+	    orchis::assert_false(cache.find(k, res));
+	}
+    }
+
+    void exif(TC)
+    {
+	Tmp tmp;
+	Cache cache {tmp.path};
+	cache.insert(key, result(21, 48));
+	anydim::Result res;
+	orchis::assert_false(cache.find(Cache::Key {1, 2, 3, 1000000000, false},
+					res));
+	cache.insert(Cache::Key {1, 2, 3, 1000000000, false}, result(48, 21));
+	orchis::assert_true(cache.find(key, res));
+	orchis::assert_eq(res.width, 21u);
+	orchis::assert_true(cache.find(Cache::Key {1, 2, 3, 1000000000, false},
+				       res));
+	orchis::assert_eq(res.width, 48u);
+    }
+
+    void shared(TC)
+    {
+	Tmp tmp;
+	Cache a {tmp.path};
+	Cache b {tmp.path};
+	a.insert(key, result(48, 21));
+	anydim::Result res;
+	orchis::assert_true(b.find(key, res));
+	orchis::assert_eq(res.width, 48u);
+    }
+
+    void uncached(TC)
+    {
+	Tmp tmp;
+	Cache cache {tmp.path};
+	anydim::Result res = result(48, 21);
+	res.error = EIO;
+	cache.insert(key, res);
+
+	const Cache::Key recent {1, 2, 3, (time(nullptr) - 1) * 1000000000LL};
+	cache.insert(recent, result(48, 21));
+
+	orchis::assert_false(cache.find(key, res));
+	orchis::assert_false(cache.find(recent, res));
+    }
+
+    void compact(TC)
+    {
+	Tmp tmp;
+	{
+	    Cache cache {tmp.path};
+	    for (unsigned i=0; i<1000; i++) {
+		cache.insert(Cache::Key {1, i, 3, 1000000000}, result(i, 21));
+	    }
+	}
+	orchis::assert_eq(Cache::compact(tmp.path, 0), 1000u);
+
+	Cache cache {tmp.path};
+	anydim::Result res;
+	orchis::assert_true(cache.find(Cache::Key {1, 42, 3, 1000000000}, res));
+	orchis::assert_eq(res.width, 42u);
+    }
+
+    void garbage(TC)
+    {
+	try {
+	    Cache cache {"test/cache.cc"};
+	}
+	catch (const std::system_error& err) {
+	    orchis::assert_eq(err.code().value(), EINVAL);
+	    return;
+	}
+	orchis::assert_true(false);
+    }
+
+    void probe(TC)
+    {
+	Tmp tmp;
+	Tmp file;
+	{
+	    std::ifstream is {"test/anydim.png"};
+	    std::ofstream os {file.path};
+	    os << is.rdbuf();
+	}
+	const timeval tv[2] = {{1000000000, 0}, {1000000000, 0}};
+	orchis::assert_eq(utimes(file.path.c_str(), tv), 0);
+
+	Cache cache {tmp.path};
+	anydim::Options options;
+	options.cache = &cache;
+
+	anydim::Result res = anydim::probe(file.path.c_str(), options);
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_true(res.octets > 0);
+
+	res = anydim::probe(file.path.c_str(), options);
+	orchis::assert_eq(res.mime, string("image/png"));
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_eq(res.height, 21u);
+	orchis::assert_eq(res.octets, 0u);
+    }
+
+    /**
+     * A file which is bad only because of --max-bytes isn't cached as
+     * bad.
+     */
+    void limited(TC)
+    {
+	Tmp tmp;
+	Tmp file;
+	{
+	    std::ifstream is {"test/anydim.png"};
+	    std::ofstream os {file.path};
+	    os << is.rdbuf();
+	}
+	const timeval tv[2] = {{1000000000, 0}, {1000000000, 0}};
+	orchis::assert_eq(utimes(file.path.c_str(), tv), 0);
+
+	Cache cache {tmp.path};
+	anydim::Options options;
+	options.cache = &cache;
+	options.max_octets = 10;
+
+	anydim::Result res = anydim::probe(file.path.c_str(), options);
+	orchis::assert_true(res.bad);
+	orchis::assert_true(res.limited);
+
+	options.max_octets = 0;
+	res = anydim::probe(file.path.c_str(), options);
+	orchis::assert_false(res.bad);
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_true(res.octets > 0);
+    }
+
+    void xattr(TC)
+    {
+	Tmp file;
+	const int fd = open(file.path.c_str(), O_RDONLY);
+	anydim::set_xattr(fd, key, result(48, 21));
+	close(fd);
+
+	char buf[100];
+	if (getxattr(file.path.c_str(), "user.anydim", buf, sizeof buf)==-1 &&
+	    errno==ENOTSUP) return;
+
+	anydim::Result res;
+	orchis::assert_true(anydim::get_xattr(file.path.c_str(), key, res));
+	orchis::assert_eq(res.mime, string("image/png"));
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_eq(res.height, 21u);
+
+	orchis::assert_false(anydim::get_xattr(file.path.c_str(),
+					       Cache::Key {1, 2, 4, 1000000000},
+					       res));
+	orchis::assert_false(anydim::get_xattr(file.path.c_str(),
+					       Cache::Key {1, 2, 3, 1000000001},
+					       res));
+	orchis::assert_true(anydim::get_xattr(file.path.c_str(),
+					      Cache::Key {7, 8, 3, 1000000000},
+					      res));
+	orchis::assert_false(anydim::get_xattr(file.path.c_str(),
+					       Cache::Key {1, 2, 3, 1000000000,
+							   false},
+					       res));
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume certain image files exist and are 48 × 21 pixels.
+ */
+#include <anydim_c.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+
+namespace {
+
+    std::vector<char> slurp(const string& file)
+    {
+	std::ifstream in {file};
+	return {std::istreambuf_iterator<char> {in},
+		std::istreambuf_iterator<char> {}};
+    }
+
+    void assert_image(const anydim_result& res, const string& mime)
+    {
+	orchis::assert_eq(res.error, 0);
+	orchis::assert_eq(res.bad, 0);
+	orchis::assert_eq(res.mime, mime);
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_eq(res.height, 21u);
+    }
+}
+
+namespace capi {
+
+    void buffer(TC)
+    {
+	anydim_result res;
+	for (int i=0; i<3; i++) {
+	    const auto v = slurp("test/anydim.jpg");
+	    orchis::assert_eq(anydim_probe_buffer(v.data(), v.size(), 0, &res), 0);
+	    assert_image(res, "image/jpeg");
+
+	    const auto w = slurp("test/anydim.ppm.gz");
+	    orchis::assert_eq(anydim_probe_buffer(w.data(), w.size(),
+						  ANYDIM_NO_EXIF, &res), 0);
+	    assert_image(res, "image/x-portable-pixmap");
+	}
+    }
+
+    void bad(TC)
+    {
+	anydim_result res;
+	const char s[] = "hello, world";
+	orchis::assert_eq(anydim_probe_buffer(s, sizeof s, 0, &res), -1);
+	orchis::assert_eq(res.error, 0);
+	orchis::assert_eq(res.bad, 1);
+
+	orchis::assert_eq(anydim_probe_buffer(s, 0, 0, &res), -1);
+	orchis::assert_eq(res.bad, 1);
+    }
+
+    void fd(TC)
+    {
+	anydim_result res;
+	const int fd = open("test/anydim.png", O_RDONLY);
+	orchis::assert_eq(anydim_probe_fd(fd, 0, &res), 0);
+	assert_image(res, "image/png");
+	close(fd);
+
+	orchis::assert_eq(anydim_probe_fd(-1, 0, &res), -1);
+	orchis::assert_eq(res.error, EBADF);
+    }
+
+    /* Fed an octet at a time, and reused.
+     */
+    void incremental(TC)
+    {
+	anydim_decoder* const d = anydim_new(0);
+	anydim_result res;
+	for (const char* file : {"test/anydim.pgm", "test/anydim.prog.jpg",
+				 "test/anydim.png.xz"}) {
+	    const auto v = slurp(file);
+	    size_t n = 0;
+	    while (n < v.size() && anydim_feed(d, &v[n], 1)==1) n++;
+	    orchis::assert_true(n < v.size());
+	    orchis::assert_eq(anydim_get(d, &res), 0);
+	    orchis::assert_eq(res.width, 48u);
+	    orchis::assert_eq(res.height, 21u);
+	    anydim_reset(d);
+	}
+	anydim_free(d);
+    }
+
+    void undecided(TC)
+    {
+	anydim_decoder* const d = anydim_new(0);
+	anydim_result res;
+	const auto v = slurp("test/anydim.jpg");
+	orchis::assert_eq(anydim_feed(d, v.data(), 10), 1);
+	orchis::assert_eq(anydim_get(d, &res), -1);
+	orchis::assert_eq(res.error, EAGAIN);
+
+	anydim_eof(d);
+	orchis::assert_eq(anydim_get(d, &res), -1);
+	orchis::assert_eq(res.error, 0);
+	orchis::assert_eq(res.bad, 1);
+	anydim_free(d);
+    }
+}
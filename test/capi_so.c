@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 Jrgen Grahn
+ * All rights reserved.
+ *
+ * A test of the C interface as a C program sees it: linked with
+ * libanydim.so.1 rather than libanydim.a.  Also checks that the
+ * incremental decoder, once it has seen each kind of image, doesn't
+ * allocate any more memory; malloc(3) and friends are replaced here
+ * with counting versions.
+ *
+ * Assumes the test images exist and are 48 x 21 pixels.
+ */
+#include <anydim_c.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t n);
+
+static int counting;
+static unsigned long allocs;
+
+void* malloc(size_t n)
+{
+    if (counting) allocs++;
+    return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    if (counting) allocs++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n)
+{
+    if (counting) allocs++;
+    return __libc_realloc(p, n);
+}
+
+struct image {
+    const char* file;
+    const char* mime;
+    unsigned char* buf;
+    size_t len;
+};
+
+static struct image images[] = {
+    {"test/anydim.jpg", "image/jpeg", 0, 0},
+    {"test/anydim.prog.jpg", "image/jpeg", 0, 0},
+    {"test/anydim.gray.jpg", "image/jpeg", 0, 0},
+    {"test/anydim.png", "image/png", 0, 0},
+    {"test/anydim.ppm", "image/x-portable-pixmap", 0, 0},
+    {"test/anydim.pgm", "image/x-portable-graymap", 0, 0},
+    {"test/anydim.pbm", "image/x-portable-bitmap", 0, 0},
+    {"test/anydim.ppm.gz", "image/x-portable-pixmap", 0, 0},
+    {"test/anydim.png.xz", "image/png", 0, 0},
+};
+static const size_t nimages = sizeof images / sizeof *images;
+
+static int failed;
+
+static void fail(const char* file, const char* what)
+{
+    fprintf(stderr, "FAIL %s: %s\n", file, what);
+    failed = 1;
+}
+
+static int slurp(struct image* im)
+{
+    FILE* f = fopen(im->file, "rb");
+    long n;
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    rewind(f);
+    im->buf = malloc(n);
+    im->len = fread(im->buf, 1, n, f);
+    fclose(f);
+    return im->len==(size_t)n;
+}
+
+static void check(const struct image* im, int rc, const struct anydim_result* res)
+{
+    if (rc) fail(im->file, "not decided");
+    else if (strcmp(res->mime, im->mime)) fail(im->file, res->mime);
+    else if (res->width!=48 || res->height!=21) fail(im->file, "dimensions");
+}
+
+/**
+ * Feed each image to 'd' in small pieces, and probe it as a buffer.
+ */
+static void probe_all(struct anydim_decoder* d)
+{
+    size_t i;
+    for (i=0; i<nimages; i++) {
+	const struct image* const im = &images[i];
+	struct anydim_result res;
+	size_t n = 0;
+	int rc = 1;
+
+	anydim_reset(d);
+	while (rc==1 && n < im->len) {
+	    const size_t k = im->len - n < 100 ? im->len - n : 100;
+	    rc = anydim_feed(d, im->buf + n, k);
+	    n += k;
+	}
+	if (rc==1) anydim_eof(d);
+	check(im, anydim_get(d, &res), &res);
+
+	check(im, anydim_probe_buffer(im->buf, im->len, 0, &res), &res);
+    }
+}
+
+int main(void)
+{
+    struct anydim_decoder* d;
+    size_t i;
+    int n;
+
+    for (i=0; i<nimages; i++) {
+	if (!slurp(&images[i])) {
+	    fail(images[i].file, "can't read");
+	    return 1;
+	}
+    }
+
+    d = anydim_new(0);
+    probe_all(d);
+
+    counting = 1;
+    for (n=0; n<3; n++) probe_all(d);
+    counting = 0;
+
+    if (allocs) {
+	fprintf(stderr, "FAIL: %lu allocations after the first round\n",
+		allocs);
+	failed = 1;
+    }
+    anydim_free(d);
+    for (i=0; i<nimages; i++) free(images[i].buf);
+    return failed;
+}
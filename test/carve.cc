@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume test/anydim.jpg and test/anydim.png exist, and
+ * are 48 × 21 pixels.
+ */
+#include <carve.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+using std::vector;
+
+namespace carve {
+
+    string slurp(const string& file)
+    {
+	std::ifstream f {file};
+	std::ostringstream ss;
+	ss << f.rdbuf();
+	return ss.str();
+    }
+
+    /**
+     * Junk which contains no candidates.
+     */
+    string junk(size_t n)
+    {
+	string s;
+	for(size_t i=0; i<n; i++) s.push_back('a' + i % 23);
+	return s;
+    }
+
+    struct Hit {
+	uint64_t offset;
+	string mime;
+    };
+
+    vector<Hit> carve(const string& s, size_t begin, size_t end)
+    {
+	vector<Hit> v;
+	anydim::Options options;
+	options.use_exif = false;
+	anydim::carve(reinterpret_cast<const uint8_t*>(s.data()), s.size(),
+		      begin, end, options,
+		      [&v] (uint64_t offset, const anydim::Result& res) {
+			  orchis::assert_eq(res.width, 48u);
+			  orchis::assert_eq(res.height, 21u);
+			  v.push_back({offset, res.mime});
+		      });
+	return v;
+    }
+
+    void test(TC)
+    {
+	const string s = junk(1001) + slurp("test/anydim.jpg")
+	    + junk(17) + "P5 " + slurp("test/anydim.png")
+	    + junk(3) + "P3\n48 21\n";
+	const size_t png = 1001 + slurp("test/anydim.jpg").size() + 17 + 3;
+
+	const vector<Hit> v = carve(s, 0, s.size());
+	orchis::assert_eq(v.size(), 3u);
+	orchis::assert_eq(v[0].offset, 1001u);
+	orchis::assert_eq(v[0].mime, "image/jpeg");
+	orchis::assert_eq(v[1].offset, png);
+	orchis::assert_eq(v[1].mime, "image/png");
+	orchis::assert_eq(v[2].offset, s.size() - 9);
+	orchis::assert_eq(v[2].mime, "image/x-portable-pixmap");
+    }
+
+    void range(TC)
+    {
+	const string s = junk(100) + slurp("test/anydim.png");
+	orchis::assert_eq(carve(s, 0, 100).size(), 0u);
+	orchis::assert_eq(carve(s, 100, 101).size(), 1u);
+	orchis::assert_eq(carve(s, 101, s.size()).size(), 0u);
+    }
+
+    void nothing(TC)
+    {
+	orchis::assert_eq(carve("", 0, 0).size(), 0u);
+	orchis::assert_eq(carve("\xff\xd8", 0, 2).size(), 0u);
+    }
+}
@@ -1,10 +1,10 @@
 /**
  * $Id: dim.cc,v 1.4 2011-01-06 12:13:38 grahn Exp $
  *
- * Copyright (c) 2011 Jrgen Grahn
+ * Copyright (c) 2011 Jörgen Grahn
  * All rights reserved.
  *
- * These tests assume certain image files exist and are 48  21 pixels.
+ * These tests assume certain image files exist and are 48 × 21 pixels.
  * If they don't, the tests flag ERROR rather than PASS/FAIL.
  * 
  */
@@ -15,6 +15,7 @@
 #include <iostream>
 #include <fstream>
 #include <errno.h>
+#include <zlib.h>
 
 #include <orchis.h>
 
@@ -88,6 +89,202 @@ namespace jfif {
     void progressive(TC) { test("test/anydim.prog.jpg", "image/jpeg"); }
 }
 
+namespace compressed {
+
+    vector<uint8_t> gzip(const string& s)
+    {
+	vector<uint8_t> gz(s.size() + 100);
+	z_stream z {};
+	deflateInit2(&z, 9, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(s.data()));
+	z.avail_in = s.size();
+	z.next_out = &gz[0];
+	z.avail_out = gz.size();
+	orchis::assert_eq(deflate(&z, Z_FINISH), Z_STREAM_END);
+	gz.resize(z.total_out);
+	deflateEnd(&z);
+	return gz;
+    }
+
+    string str(const vector<uint8_t>& v)
+    {
+	return {v.begin(), v.end()};
+    }
+
+    void gz(TC) { test("test/anydim.ppm.gz", "image/x-portable-pixmap"); }
+    void xz(TC) { test("test/anydim.png.xz", "image/png"); }
+
+    /**
+     * A gzipped 3000x2000 PPM should be decided long before the
+     * compressed data ends.
+     */
+    void early(TC)
+    {
+	string ppm = "P6\n3000 2000\n255\n";
+	ppm.resize(ppm.size() + 3000*2000*3, '\x55');
+	const vector<uint8_t> gz = gzip(ppm);
+
+	anydim::AnyDim dim {false};
+	const uint8_t* a = &gz[0];
+	while(dim.undecided() && a + 10 < &gz[0] + gz.size()) {
+	    dim.feed(a, a+10);
+	    a += 10;
+	}
+	orchis::assert_(!dim.bad());
+	orchis::assert_eq(dim.width, 3000u);
+	orchis::assert_eq(dim.height, 2000u);
+	orchis::assert_(a - &gz[0] < 100);
+    }
+
+    void corrupt(TC)
+    {
+	const uint8_t gz[] = {0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0, 0x03,
+			      0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+	anydim::AnyDim dim {false};
+	dim.feed(gz, gz + sizeof gz);
+	dim.eof();
+	orchis::assert_(dim.bad());
+    }
+
+    /**
+     * Only one level of compression is unwrapped, so gzip in gzip in
+     * ... can't exhaust the stack.
+     */
+    void nested(TC)
+    {
+	string s = "P6\n48 21\n255\n";
+	s.resize(s.size() + 48*21*3, '\0');
+	s = str(gzip(s));
+	{
+	    anydim::AnyDim dim {false};
+	    dim.feed(reinterpret_cast<const uint8_t*>(s.data()),
+		     reinterpret_cast<const uint8_t*>(s.data()) + s.size());
+	    orchis::assert_eq(dim.width, 48u);
+	}
+
+	for(int i=0; i<1000; i++) s = str(gzip(s));
+	anydim::AnyDim dim {false};
+	dim.feed(reinterpret_cast<const uint8_t*>(s.data()),
+		 reinterpret_cast<const uint8_t*>(s.data()) + s.size());
+	if(dim.undecided()) dim.eof();
+	orchis::assert_(dim.bad());
+    }
+
+    /**
+     * test/anydim.png.xz, but with its block header claiming a 1.5 GiB
+     * dictionary, which we refuse to allocate.
+     */
+    void xz_dictionary(TC)
+    {
+	vector<uint8_t> xz;
+	read(xz, "test/anydim.png.xz");
+	orchis::assert_eq(xz[12], 0x04);	// block header, 20 octets
+	orchis::assert_eq(xz[18], 0x21);	// LZMA2
+	orchis::assert_eq(xz[19], 0x01);
+	xz[20] = 37;
+	const uLong crc = crc32(0, &xz[12], 16);
+	for(unsigned i=0; i<4; i++) xz[28 + i] = crc >> 8*i;
+
+	anydim::AnyDim dim {false};
+	dim.feed(&xz[0], &xz[0] + xz.size());
+	if(dim.undecided()) dim.eof();
+	orchis::assert_(dim.bad());
+    }
+
+    /**
+     * The limit applies to the decompressed data too, or a small file
+     * could make us decompress gigabytes.
+     */
+    void limit(TC)
+    {
+	string ppm = "P6\n#";
+	ppm.resize(ppm.size() + 100000, 'x');
+	ppm += "\n48 21\n255\n";
+	const vector<uint8_t> gz = gzip(ppm);
+	orchis::assert_(gz.size() < 1000);
+
+	anydim::AnyDim dim {false, 1000};
+	dim.feed(&gz[0], &gz[0] + gz.size());
+	if(dim.undecided()) dim.eof();
+	orchis::assert_(dim.bad());
+
+	anydim::AnyDim unlimited {false};
+	unlimited.feed(&gz[0], &gz[0] + gz.size());
+	orchis::assert_eq(unlimited.width, 48u);
+    }
+}
+
+namespace plan {
+
+    const uint8_t jpeg[] = {
+	0xff, 0xd8,
+	0xff, 0xe2, 0xf0, 0x00, 'I', 'C', 'C'
+    };
+    const uint8_t sof[] = {
+	0xff, 0xc0, 0x00, 0x0b, 0x08, 0x00, 0x15, 0x00, 0x30, 0x01, 0, 0, 0
+    };
+
+    void jpeg_skip(TC)
+    {
+	anydim::AnyDim dim {false};
+	dim.feed(jpeg, jpeg + sizeof jpeg);
+	orchis::assert_(dim.undecided());
+	orchis::assert_eq(dim.skippable(), 0xf000u - 2 - 3);
+	dim.skip(dim.skippable());
+	orchis::assert_eq(dim.skippable(), 0u);
+	dim.feed(sof, sof + sizeof sof);
+	orchis::assert_(!dim.undecided());
+	orchis::assert_eq(dim.mime(), string("image/jpeg"));
+	orchis::assert_eq(dim.width, 48u);
+	orchis::assert_eq(dim.height, 21u);
+    }
+
+    void sof_not_skipped(TC)
+    {
+	anydim::AnyDim dim {false};
+	dim.feed(jpeg, jpeg + 2);
+	dim.feed(sof, sof + 6);
+	orchis::assert_eq(dim.skippable(), 0u);
+    }
+
+    void png_want(TC)
+    {
+	anydim::PngDim dim;
+	orchis::assert_eq(dim.want(), 24u);
+	const uint8_t sig[] = {0x89, 0x50, 0x4e, 0x47};
+	dim.feed(sig, sig + sizeof sig);
+	orchis::assert_eq(dim.want(), 20u);
+    }
+
+    void limit(TC)
+    {
+	anydim::AnyDim dim {false, 100};
+	orchis::assert_eq(dim.want(), 100u);
+	dim.feed(jpeg, jpeg + sizeof jpeg);
+	orchis::assert_eq(dim.skippable(), 100u - sizeof jpeg);
+	dim.skip(dim.skippable());
+	orchis::assert_(dim.bad());
+    }
+
+    void within_limit(TC)
+    {
+	anydim::AnyDim dim {false, 2 + sizeof sof};
+	dim.feed(jpeg, jpeg + 2);
+	dim.feed(sof, sof + sizeof sof);
+	orchis::assert_(!dim.undecided());
+	orchis::assert_(!dim.bad());
+    }
+
+    void comment(TC)
+    {
+	const std::string s = "P6\n# " + std::string(1000, 'x');
+	anydim::AnyDim dim {false, 500};
+	dim.feed(reinterpret_cast<const uint8_t*>(s.data()),
+		 reinterpret_cast<const uint8_t*>(s.data() + s.size()));
+	orchis::assert_(dim.bad());
+    }
+}
+
 namespace garbage {
 
     /* 10K of garbage should be enough to decide there's no
@@ -112,3 +309,88 @@ namespace garbage {
 	orchis::assert_(dim.bad());
     }
 }
+
+namespace reset {
+
+    void feed(anydim::AnyDim& dim, const string& file)
+    {
+	vector<uint8_t> img;
+	read(img, file);
+	dim.reset();
+	dim.feed(img.data(), img.data() + img.size());
+	if(dim.undecided()) dim.eof();
+    }
+
+    /* One AnyDim, reused across formats, and after deciding a
+     * file is bad.
+     */
+    void test(TC)
+    {
+	anydim::AnyDim dim {false};
+	const char* const files[] = {
+	    "test/anydim.jpg", "test/anydim.ppm.gz", "test/anydim.png",
+	    "test/dim.cc", "test/anydim.pgm", "test/anydim.png.xz",
+	    "test/anydim.ppm.gz", "test/anydim.prog.jpg",
+	};
+	const char* const mimes[] = {
+	    "image/jpeg", "image/x-portable-pixmap", "image/png",
+	    "", "image/x-portable-graymap", "image/png",
+	    "image/x-portable-pixmap", "image/jpeg",
+	};
+	for(unsigned i=0; i < sizeof files / sizeof *files; i++) {
+	    feed(dim, files[i]);
+	    if(!*mimes[i]) {
+		orchis::assert_(dim.bad());
+		continue;
+	    }
+	    orchis::assert_eq(dim.bad(), false);
+	    orchis::assert_eq(dim.mime(), string(mimes[i]));
+	    orchis::assert_eq(dim.width, 48u);
+	    orchis::assert_eq(dim.height, 21u);
+	}
+    }
+}
+
+namespace probe {
+
+    void test(const string& file, const string& mime)
+    {
+	anydim::Options options;
+	options.use_exif = false;
+	const anydim::Result res = anydim::probe(file.c_str(), options);
+	orchis::assert_eq(res.error, 0);
+	orchis::assert_eq(res.bad, false);
+	orchis::assert_eq(res.mime, mime);
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_eq(res.height, 21u);
+    }
+
+    void ppm(TC) { test("test/anydim.ppm", "image/x-portable-pixmap"); }
+    void png(TC) { test("test/anydim.png", "image/png"); }
+    void jpeg(TC) { test("test/anydim.jpg", "image/jpeg"); }
+
+    void tally(TC)
+    {
+	anydim::Result res;
+	res.tally(0, 4096);
+	res.tally(4096, 100);
+	res.tally(4196, 100);
+	res.tally(20000, 8192);
+	orchis::assert_eq(res.octets, 4096u + 100 + 100 + 8192);
+	orchis::assert_eq(res.offset, 28192u);
+	orchis::assert_eq(res.pages, 1u + 1 + 3);
+    }
+
+    void missing(TC)
+    {
+	const anydim::Result res = anydim::probe("test/nonexistent.png");
+	orchis::assert_eq(res.error, ENOENT);
+    }
+
+    void garbage(TC)
+    {
+	const anydim::Result res = anydim::probe("test/dim.cc");
+	orchis::assert_eq(res.error, 0);
+	orchis::assert_eq(res.bad, true);
+    }
+}
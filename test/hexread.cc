@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2012 Jrgen Grahn
+ * Copyright (c) 2012 Jörgen Grahn
  * All rights reserved.
  *
  */
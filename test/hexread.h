@@ -1,6 +1,6 @@
 /* -*- c++ -*-
  *
- * Copyright (c) 2012, 2019 Jrgen Grahn.
+ * Copyright (c) 2012, 2019 Jörgen Grahn.
  * All rights reserved.
  *
  */
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests run a small HTTP server on localhost, serving the test
+ * images, and assume they exist and are 48 × 21 pixels.
+ */
+#include <http.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+
+namespace http {
+
+    /**
+     * Serves files from the current directory, one connection at a
+     * time, with keep-alive and (if 'partial') Range support.  It
+     * remembers the paths and Ranges requested, and counts the octets
+     * sent (before sending them, so the count is complete once the
+     * client has read a response).
+     */
+    class Server {
+    public:
+	explicit Server(bool partial);
+	~Server();
+
+	string url(const string& path) const;
+
+	std::atomic<unsigned> connections {0};
+	std::atomic<unsigned> requests {0};
+	std::atomic<unsigned long> octets {0};
+
+	std::vector<string> paths() const;
+	std::vector<string> ranges() const;
+
+    private:
+	const bool partial;
+	int fd;
+	mutable std::mutex mutex;
+	std::vector<string> paths_;
+	std::vector<string> ranges_;
+	unsigned port;
+	std::thread thread;
+
+	void run();
+	void serve(int c);
+    };
+
+    Server::Server(bool partial)
+	: partial {partial}
+    {
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in sa {};
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof sa;
+	bind(fd, reinterpret_cast<sockaddr*>(&sa), len);
+	listen(fd, 5);
+	getsockname(fd, reinterpret_cast<sockaddr*>(&sa), &len);
+	port = ntohs(sa.sin_port);
+	thread = std::thread {&Server::run, this};
+    }
+
+    Server::~Server()
+    {
+	shutdown(fd, SHUT_RDWR);
+	thread.join();
+	close(fd);
+    }
+
+    std::vector<string> Server::paths() const
+    {
+	std::lock_guard<std::mutex> lock {mutex};
+	return paths_;
+    }
+
+    std::vector<string> Server::ranges() const
+    {
+	std::lock_guard<std::mutex> lock {mutex};
+	return ranges_;
+    }
+
+    string Server::url(const string& path) const
+    {
+	return "http://127.0.0.1:" + std::to_string(port) + '/' + path;
+    }
+
+    void Server::run()
+    {
+	while(true) {
+	    const int c = accept(fd, nullptr, nullptr);
+	    if(c==-1) break;
+	    connections++;
+	    serve(c);
+	    close(c);
+	}
+    }
+
+    void Server::serve(int c)
+    {
+	string in;
+	char buf[4096];
+	while(true) {
+	    const auto end = in.find("\r\n\r\n");
+	    if(end==string::npos) {
+		const ssize_t n = recv(c, buf, sizeof buf, 0);
+		if(n <= 0) return;
+		in.append(buf, n);
+		continue;
+	    }
+	    const string head = in.substr(0, end);
+	    in.erase(0, end + 4);
+	    requests++;
+
+	    std::istringstream is {head};
+	    string method, path;
+	    is >> method >> path;
+	    const auto r = head.find("Range: bytes=");
+	    {
+		std::lock_guard<std::mutex> lock {mutex};
+		paths_.push_back(path);
+		if(r!=string::npos) {
+		    ranges_.push_back(head.substr(r + 13,
+						  head.find('\r', r) - r - 13));
+		}
+	    }
+	    std::ifstream f {path.substr(1)};
+	    std::ostringstream ss;
+	    ss << f.rdbuf();
+	    const string data = ss.str();
+
+	    string resp;
+	    if(!f) {
+		resp = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+	    }
+	    else {
+		if(partial && r!=string::npos) {
+		    const char* p = head.c_str() + r + 13;
+		    char* q;
+		    const size_t a = std::strtoul(p, &q, 10);
+		    size_t b = std::strtoul(q + 1, nullptr, 10);
+		    b = std::min(b, data.size() - 1);
+		    const string body = data.substr(a, b - a + 1);
+		    resp = "HTTP/1.1 206 Partial Content\r\n"
+			"Content-Range: bytes " + std::to_string(a) + '-'
+			+ std::to_string(b) + '/' + std::to_string(data.size())
+			+ "\r\nContent-Length: " + std::to_string(body.size())
+			+ "\r\n\r\n" + body;
+		}
+		else {
+		    resp = "HTTP/1.1 200 OK\r\nContent-Length: "
+			+ std::to_string(data.size()) + "\r\n\r\n" + data;
+		}
+	    }
+	    octets += resp.size();
+	    if(send(c, resp.data(), resp.size(), MSG_NOSIGNAL)!=ssize_t(resp.size())) {
+		return;
+	    }
+	}
+    }
+
+    void check(const anydim::Result& res, const string& mime)
+    {
+	orchis::assert_eq(res.error, 0);
+	orchis::assert_eq(res.bad, false);
+	orchis::assert_eq(res.mime, mime);
+	orchis::assert_eq(res.width, 48u);
+	orchis::assert_eq(res.height, 21u);
+    }
+
+    anydim::Options options()
+    {
+	anydim::Options options;
+	options.use_exif = false;
+	return options;
+    }
+
+    void ranges(TC)
+    {
+	Server server {true};
+	anydim::Http http;
+	check(http.probe(server.url("test/anydim.png"), options()), "image/png");
+	check(http.probe(server.url("test/anydim.jpg"), options()), "image/jpeg");
+	check(http.probe(server.url("test/anydim.ppm"), options()),
+	      "image/x-portable-pixmap");
+	orchis::assert_eq(server.connections, 1u);
+	const std::vector<string> r = server.ranges();
+	orchis::assert_eq(r.size(), 3u);
+	for(const string& s : r) orchis::assert_eq(s, "0-4095");
+	orchis::assert_(server.octets < 3 * 4096u + 1000);
+    }
+
+    void skip(TC)
+    {
+	Server server {true};
+	anydim::Http http;
+	check(http.probe(server.url("test/anydim.gray.jpg"), options()),
+	      "image/jpeg");
+	/* the first 4K, and then the rest, past the ICC profile */
+	const std::vector<string> r = server.ranges();
+	orchis::assert_eq(r.size(), 2u);
+	orchis::assert_eq(r[0], "0-4095");
+	orchis::assert_(std::strtoul(r[1].c_str(), nullptr, 10) > 4096 + 16384);
+    }
+
+    void whole(TC)
+    {
+	Server server {false};
+	anydim::Http http;
+	check(http.probe(server.url("test/anydim.png"), options()), "image/png");
+	check(http.probe(server.url("test/anydim.ppm"), options()),
+	      "image/x-portable-pixmap");
+    }
+
+    void missing(TC)
+    {
+	Server server {true};
+	anydim::Http http;
+	const auto res = http.probe(server.url("test/nonexistent.png"), options());
+	orchis::assert_eq(res.error, ENOENT);
+    }
+
+    /**
+     * A CR LF in the name mustn't end up as a header in the request.
+     */
+    void control(TC)
+    {
+	Server server {true};
+	anydim::Http http;
+	const auto res = http.probe(server.url("test/x\r\nX-Foo: bar"),
+				    options());
+	orchis::assert_eq(res.error, ENOENT);
+	orchis::assert_eq(server.requests, 1u);
+	orchis::assert_eq(server.paths().at(0), "/test/x%0D%0AX-Foo:%20bar");
+    }
+
+    void https(TC)
+    {
+	anydim::Http http;
+	const auto res = http.probe("https://localhost/foo.png", options());
+	orchis::assert_eq(res.error, EPROTONOSUPPORT);
+    }
+}
@@ -117,6 +117,61 @@ namespace jfif {
 	}
     }
 
+    namespace skip {
+
+	void segment(orchis::TC)
+	{
+	    const auto a = h("ffd8"
+			     "ffe2 0008 0102");
+	    const auto b = h("ffe0 0003 69"
+			     "ffd9");
+
+	    Decoder decoder;
+	    decoder.feed(a.data(), a.data() + a.size());
+	    orchis::assert_eq(decoder.marker(), 0xe2u);
+	    orchis::assert_eq(decoder.skippable(), 4u);
+	    decoder.skip(4);
+	    orchis::assert_eq(decoder.marker(), 0u);
+	    orchis::assert_eq(decoder.skippable(), 0u);
+	    decoder.feed(b.data(), b.data() + b.size());
+
+	    const std::vector<Segment> ref {{0xd8, h("")},
+					    {0xe2, h("0102")},
+					    {0xe0, h("69")},
+					    {0xd9, h("")}};
+	    orchis::assert_(decoder.end() == ref);
+	}
+
+	void partial(orchis::TC)
+	{
+	    const auto a = h("ffd8"
+			     "ffe2 0008 0102");
+	    const auto b = h("0304"
+			     "ffd9");
+
+	    Decoder decoder;
+	    decoder.feed(a.data(), a.data() + a.size());
+	    decoder.skip(2);
+	    orchis::assert_eq(decoder.skippable(), 2u);
+	    decoder.feed(b.data(), b.data() + b.size());
+
+	    const std::vector<Segment> ref {{0xd8, h("")},
+					    {0xe2, h("01020304")},
+					    {0xd9, h("")}};
+	    orchis::assert_(decoder.end() == ref);
+	}
+
+	void nothing(orchis::TC)
+	{
+	    const auto a = h("ffd8"
+			     "ffe2 00");
+
+	    Decoder decoder;
+	    decoder.feed(a.data(), a.data() + a.size());
+	    orchis::assert_eq(decoder.skippable(), 0u);
+	}
+    }
+
     namespace bad {
 
 	void empty(orchis::TC)
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume test/anydim.jpg exists, and is 48 × 21 pixels.
+ */
+#include <anydim.h>
+#include <memo.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+
+namespace memo {
+
+    string slurp(const string& file)
+    {
+	std::ifstream f {file};
+	std::ostringstream ss;
+	ss << f.rdbuf();
+	return ss.str();
+    }
+
+    /**
+     * Feed all of 's' to 'dim', 'n' octets at a time, until it
+     * decides.
+     */
+    void feed(anydim::Dim& dim, const string& s, size_t n = 4096)
+    {
+	auto a = reinterpret_cast<const uint8_t*>(s.data());
+	const auto b = a + s.size();
+	while (a!=b && dim.undecided()) {
+	    const auto c = a + std::min(n, size_t(b-a));
+	    dim.feed(a, c);
+	    a = c;
+	}
+	if (dim.undecided()) dim.eof();
+    }
+
+    void unused(TC)
+    {
+	anydim::PnmDim pnm;
+	feed(pnm, "P5 48 21 255\nxyz");
+	orchis::assert_eq(pnm.height, 21u);
+	orchis::assert_eq(pnm.unused(), 7u);
+
+	anydim::PngDim png;
+	feed(png, slurp("test/anydim.png"));
+	orchis::assert_eq(png.height, 21u);
+	orchis::assert_eq(png.unused(), slurp("test/anydim.png").size() - 24);
+
+	const string jpeg = slurp("test/anydim.jpg");
+	anydim::JpegDim jdim {false};
+	feed(jdim, jpeg, jpeg.size());
+	orchis::assert_eq(jdim.height, 21u);
+	const size_t sof = jpeg.find("\xff\xc0");
+	const size_t len = uint8_t(jpeg[sof+2]) << 8 | uint8_t(jpeg[sof+3]);
+	orchis::assert_eq(jpeg.size() - jdim.unused(), sof + 2 + len);
+    }
+
+    void pnm(TC)
+    {
+	anydim::Memo memo;
+	anydim::AnyDim a {false, 0, &memo};
+	feed(a, "P5 48 21 255\nxyz");
+	orchis::assert_eq(a.width, 48u);
+
+	anydim::AnyDim b {false, 0, &memo};
+	feed(b, "P5 48 21 77\nabcdefgh", 3);
+	orchis::assert_eq(b.mime(), string("image/x-portable-graymap"));
+	orchis::assert_eq(b.width, 48u);
+	orchis::assert_eq(b.height, 21u);
+
+	anydim::AnyDim c {false, 0, &memo};
+	feed(c, "P5 48 22 255\nxyz");
+	orchis::assert_eq(c.height, 22u);
+
+	std::ostringstream ss;
+	memo.put(ss);
+	orchis::assert_eq(ss.str(), "memo hits:     1\n"
+			  "memo headers:  2\n");
+    }
+
+    void jpeg(TC)
+    {
+	anydim::Memo memo;
+	string jpeg = slurp("test/anydim.jpg");
+	anydim::AnyDim a {false, 0, &memo};
+	feed(a, jpeg);
+
+	jpeg[jpeg.size() - 3] ^= 1;
+	anydim::AnyDim b {false, 0, &memo};
+	feed(b, jpeg, 100);
+	orchis::assert_false(b.undecided());
+	orchis::assert_eq(b.mime(), string("image/jpeg"));
+	orchis::assert_eq(b.width, 48u);
+	orchis::assert_eq(b.height, 21u);
+
+	std::ostringstream ss;
+	memo.put(ss);
+	orchis::assert_eq(ss.str(), "memo hits:     1\n"
+			  "memo headers:  1\n");
+    }
+
+    void bad(TC)
+    {
+	anydim::Memo memo;
+	anydim::AnyDim a {false, 0, &memo};
+	feed(a, "P5 48 21 255\nxyz");
+
+	anydim::AnyDim b {false, 0, &memo};
+	feed(b, "P5 48 21");
+	orchis::assert_true(b.bad());
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include <png.h>
+
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+
+namespace {
+
+    void put32(string& s, unsigned n)
+    {
+	s += char(n >> 24);
+	s += char(n >> 16);
+	s += char(n >> 8);
+	s += char(n);
+    }
+
+    string chunk(const string& type, const string& data)
+    {
+	string s;
+	put32(s, data.size());
+	const string td = type + data;
+	s += td;
+	put32(s, crc32(0, reinterpret_cast<const uint8_t*>(td.data()),
+		       td.size()));
+	return s;
+    }
+
+    string ihdr(unsigned width, unsigned height)
+    {
+	string s;
+	put32(s, width);
+	put32(s, height);
+	s += string("\x08\x02\x00\x00\x00", 5);
+	return chunk("IHDR", s);
+    }
+
+    string text(const string& key, const string& value)
+    {
+	return chunk("tEXt", key + '\0' + value);
+    }
+
+    const string signature = "\x89PNG\r\n\x1a\n";
+
+    std::vector<png::Chunk> parse(const string& s)
+    {
+	auto a = reinterpret_cast<const uint8_t*>(s.data());
+	return png::chunks(a, a + s.size());
+    }
+}
+
+namespace chunks {
+
+    void simple(TC)
+    {
+	const string s = signature + ihdr(48, 21)
+	    + text("Thumb::URI", "file:///foo.png")
+	    + text("Thumb::MTime", "1234")
+	    + chunk("IDAT", "xxxx")
+	    + text("Late", "ignored")
+	    + chunk("IEND", "");
+	const auto v = parse(s);
+	orchis::assert_eq(v.size(), 3u);
+	orchis::assert_eq(v[0].type, "IHDR");
+	orchis::assert_eq(v[0].v.size(), 13u);
+
+	auto m = png::text(v);
+	orchis::assert_eq(m.size(), 2u);
+	orchis::assert_eq(m["Thumb::URI"], "file:///foo.png");
+	orchis::assert_eq(m["Thumb::MTime"], "1234");
+    }
+
+    void truncated(TC)
+    {
+	const string s = signature + ihdr(48, 21)
+	    + text("Thumb::URI", "file:///foo.png");
+	const auto v = parse(s.substr(0, s.size() - 5));
+	orchis::assert_eq(v.size(), 1u);
+    }
+
+    void iend(TC)
+    {
+	const string s = signature + ihdr(48, 21) + chunk("IEND", "")
+	    + "garbage";
+	orchis::assert_eq(parse(s).size(), 2u);
+    }
+
+    void corrupt(TC)
+    {
+	string s = signature + ihdr(48, 21) + text("a", "b");
+	s[s.size() - 6]++;
+	try {
+	    parse(s);
+	    orchis::assert_true(false);
+	}
+	catch (const png::Error&) {}
+    }
+
+    void not_png(TC)
+    {
+	try {
+	    parse("P6\n48 21\n255\n");
+	    orchis::assert_true(false);
+	}
+	catch (const png::Error&) {}
+    }
+
+    void no_keyword(TC)
+    {
+	const string s = signature + ihdr(48, 21) + chunk("tEXt", "foo");
+	orchis::assert_true(png::text(parse(s)).empty());
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume test/anydim.tar exists, holding test/anydim.ppm
+ * and test/anydim.png.
+ */
+#include <archive.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+using std::vector;
+
+namespace tar {
+
+    struct Member {
+	string name;
+	anydim::Result res;
+    };
+
+    int probe(int fd, vector<Member>& v)
+    {
+	anydim::Options options;
+	options.use_exif = false;
+	return anydim::probe_tar(fd, options,
+				 [&v] (const string& name,
+				       const anydim::Result& res) {
+				     v.push_back({name, res});
+				 });
+    }
+
+    void check(const vector<Member>& v)
+    {
+	orchis::assert_eq(v.size(), 2u);
+	orchis::assert_eq(v[0].name, "test/anydim.ppm");
+	orchis::assert_eq(v[0].res.mime, string("image/x-portable-pixmap"));
+	orchis::assert_eq(v[1].name, "test/anydim.png");
+	orchis::assert_eq(v[1].res.mime, string("image/png"));
+	for(const Member& m : v) {
+	    orchis::assert_eq(m.res.width, 48u);
+	    orchis::assert_eq(m.res.height, 21u);
+	}
+    }
+
+    void file(TC)
+    {
+	const int fd = open("test/anydim.tar", O_RDONLY);
+	vector<Member> v;
+	orchis::assert_eq(probe(fd, v), 0);
+	close(fd);
+	check(v);
+    }
+
+    void pipe(TC)
+    {
+	int p[2];
+	orchis::assert_eq(::pipe(p), 0);
+	std::thread writer {[&p] {
+		const int fd = open("test/anydim.tar", O_RDONLY);
+		char buf[1000];
+		ssize_t n;
+		while((n = read(fd, buf, sizeof buf)) > 0) {
+		    if(write(p[1], buf, n)!=n) break;
+		}
+		close(fd);
+		close(p[1]);
+	    }};
+	vector<Member> v;
+	const int err = probe(p[0], v);
+	writer.join();
+	close(p[0]);
+	orchis::assert_eq(err, 0);
+	check(v);
+    }
+
+    /**
+     * An archive truncated in the middle of a member is an error,
+     * whether we seek past the member or read through it.
+     */
+    void truncated(TC)
+    {
+	FILE* const f = tmpfile();
+	const int fd = fileno(f);
+	{
+	    const int src = open("test/anydim.tar", O_RDONLY);
+	    char buf[700];
+	    orchis::assert_eq(read(src, buf, sizeof buf), 700);
+	    close(src);
+	    orchis::assert_eq(write(fd, buf, sizeof buf), 700);
+	    lseek(fd, 0, SEEK_SET);
+	}
+	vector<Member> v;
+	orchis::assert_eq(probe(fd, v), EINVAL);
+	fclose(f);
+    }
+
+    void garbage(TC)
+    {
+	const int fd = open("test/tar.cc", O_RDONLY);
+	vector<Member> v;
+	orchis::assert_eq(probe(fd, v), EINVAL);
+	close(fd);
+	orchis::assert_eq(v.size(), 0u);
+    }
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume test/anydim.png exists, and is 48 × 21 pixels.
+ */
+#include <thumb.h>
+
+#include <string>
+#include <fstream>
+
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+
+namespace {
+
+    void put32(string& s, unsigned n)
+    {
+	s += char(n >> 24);
+	s += char(n >> 16);
+	s += char(n >> 8);
+	s += char(n);
+    }
+
+    string chunk(const string& type, const string& data)
+    {
+	string s;
+	put32(s, data.size());
+	const string td = type + data;
+	s += td;
+	put32(s, crc32(0, reinterpret_cast<const uint8_t*>(td.data()),
+		       td.size()));
+	return s;
+    }
+
+    string text(const string& key, const string& value)
+    {
+	return chunk("tEXt", key + '\0' + value);
+    }
+
+    /**
+     * A thumbnail cache in a temporary directory, as XDG_CACHE_HOME,
+     * removed at the end of the test.
+     */
+    struct Thumbnails {
+	Thumbnails()
+	    : dir {"/tmp/anydim.XXXXXX"}
+	{
+	    mkdtemp(&dir[0]);
+	    mkdir((dir + "/thumbnails").c_str(), 0700);
+	    mkdir((dir + "/thumbnails/normal").c_str(), 0700);
+	    setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+	}
+	~Thumbnails()
+	{
+	    unlink(file.c_str());
+	    rmdir((dir + "/thumbnails/normal").c_str());
+	    rmdir((dir + "/thumbnails").c_str());
+	    rmdir(dir.c_str());
+	    unsetenv("XDG_CACHE_HOME");
+	}
+
+	/**
+	 * Write a 'tw' × 'th' thumbnail for 'path', which is said to
+	 * be a 'mime' of 'width' × 'height', with modification time
+	 * 'mtime'.
+	 */
+	void put(const string& path, const string& mime,
+		 unsigned width, unsigned height, time_t mtime,
+		 unsigned tw = 128, unsigned th = 56)
+	{
+	    const string uri = anydim::file_uri(path);
+	    string hdr;
+	    put32(hdr, tw);
+	    put32(hdr, th);
+	    hdr += string("\x08\x02\x00\x00\x00", 5);
+
+	    file = dir + "/thumbnails/normal/" + anydim::thumbnail_name(uri);
+	    std::ofstream os {file};
+	    os << "\x89PNG\r\n\x1a\n"
+	       << chunk("IHDR", hdr)
+	       << text("Thumb::URI", uri)
+	       << text("Thumb::MTime", std::to_string(mtime))
+	       << text("Thumb::Mime", mime)
+	       << text("Thumb::Image::Width", std::to_string(width))
+	       << text("Thumb::Image::Height", std::to_string(height))
+	       << chunk("IDAT", "")
+	       << chunk("IEND", "");
+	}
+
+	string dir;
+	string file;
+    };
+
+    const char png[] = "test/anydim.png";
+
+    anydim::Cache::Key key()
+    {
+	struct stat st;
+	stat(png, &st);
+	return anydim::Cache::Key {st, true};
+    }
+
+    time_t mtime()
+    {
+	struct stat st;
+	stat(png, &st);
+	return st.st_mtime;
+    }
+}
+
+namespace thumb {
+
+    void name(TC)
+    {
+	/* the example in the thumbnail spec */
+	orchis::assert_eq(anydim::thumbnail_name("file:///home/jens/photos/me.png"),
+			  "c6ee772d9e49320e97ec29a7eb5b1697.png");
+	orchis::assert_eq(anydim::thumbnail_name(""),
+			  "d41d8cd98f00b204e9800998ecf8427e.png");
+	orchis::assert_eq(anydim::thumbnail_name(string(200, 'a')),
+			  "887f30b43b2867f4a9accceee7d16e6c.png");
+    }
+
+    void uri(TC)
+    {
+	orchis::assert_eq(anydim::file_uri("/home/jens/photos/me.png"),
+			  "file:///home/jens/photos/me.png");
+	orchis::assert_eq(anydim::file_uri("/a b/\xc3\xa4#.png"),
+			  "file:///a%20b/%C3%A4%23.png");
+	orchis::assert_eq(anydim::file_uri("//a/./b/../c.png"),
+			  "file:///a/c.png");
+	char buf[4096];
+	orchis::assert_eq(anydim::file_uri("test/../x.png"),
+			  "file://" + string(getcwd(buf, sizeof buf)) + "/x.png");
+    }
+
+    void found(TC)
+    {
+	Thumbnails thumbnails;
+	thumbnails.put(png, "image/png", 4000, 3000, mtime());
+	anydim::Result res;
+	orchis::assert_true(anydim::get_thumbnail(png, key(), true, res));
+	orchis::assert_eq(res.mime, string("image/png"));
+	orchis::assert_eq(res.width, 4000u);
+	orchis::assert_eq(res.height, 3000u);
+    }
+
+    void stale(TC)
+    {
+	Thumbnails thumbnails;
+	thumbnails.put(png, "image/png", 4000, 3000, mtime() - 1);
+	anydim::Result res;
+	orchis::assert_false(anydim::get_thumbnail(png, key(), true, res));
+    }
+
+    void missing(TC)
+    {
+	Thumbnails thumbnails;
+	anydim::Result res;
+	orchis::assert_false(anydim::get_thumbnail(png, key(), true, res));
+    }
+
+    void unknown_mime(TC)
+    {
+	Thumbnails thumbnails;
+	thumbnails.put(png, "image/gif", 4000, 3000, mtime());
+	anydim::Result res;
+	orchis::assert_false(anydim::get_thumbnail(png, key(), true, res));
+    }
+
+    /* A JPEG thumbnail is rotated like the image is shown, so with
+     * Exif, that decides the order of width and height.
+     */
+    void orientation(TC)
+    {
+	Thumbnails thumbnails;
+	anydim::Result res;
+	thumbnails.put(png, "image/jpeg", 4000, 3000, mtime(), 96, 128);
+	orchis::assert_true(anydim::get_thumbnail(png, key(), true, res));
+	orchis::assert_eq(res.width, 3000u);
+	orchis::assert_eq(res.height, 4000u);
+	orchis::assert_true(anydim::get_thumbnail(png, key(), false, res));
+	orchis::assert_eq(res.width, 4000u);
+	orchis::assert_eq(res.height, 3000u);
+
+	thumbnails.put(png, "image/jpeg", 4000, 3000, mtime(), 128, 128);
+	orchis::assert_false(anydim::get_thumbnail(png, key(), true, res));
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ * These tests assume test/anydim.zip exists, holding test/anydim.ppm
+ * and test/anydim.png (deflated, if zip(1) finds it worthwhile) and
+ * test/anydim.jpg (stored).
+ */
+#include <archive.h>
+
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <orchis.h>
+
+using orchis::TC;
+
+using std::string;
+using std::vector;
+
+namespace zip {
+
+    struct Member {
+	string name;
+	anydim::Result res;
+    };
+
+    int probe(const char* file, vector<Member>& v)
+    {
+	anydim::Options options;
+	options.use_exif = false;
+	const int fd = open(file, O_RDONLY);
+	const int err = anydim::probe_zip(fd, options,
+					  [&v] (const string& name,
+						const anydim::Result& res) {
+					      v.push_back({name, res});
+					  });
+	close(fd);
+	return err;
+    }
+
+    void test(TC)
+    {
+	vector<Member> v;
+	orchis::assert_eq(probe("test/anydim.zip", v), 0);
+	orchis::assert_eq(v.size(), 3u);
+	orchis::assert_eq(v[0].name, "test/anydim.ppm");
+	orchis::assert_eq(v[0].res.mime, string("image/x-portable-pixmap"));
+	orchis::assert_eq(v[1].name, "test/anydim.png");
+	orchis::assert_eq(v[1].res.mime, string("image/png"));
+	orchis::assert_eq(v[2].name, "test/anydim.jpg");
+	orchis::assert_eq(v[2].res.mime, string("image/jpeg"));
+	for(const Member& m : v) {
+	    orchis::assert_eq(m.res.error, 0);
+	    orchis::assert_eq(m.res.width, 48u);
+	    orchis::assert_eq(m.res.height, 21u);
+	}
+    }
+
+    void garbage(TC)
+    {
+	vector<Member> v;
+	orchis::assert_eq(probe("test/zip.cc", v), EINVAL);
+	orchis::assert_eq(v.size(), 0u);
+    }
+
+    void pipe(TC)
+    {
+	int p[2];
+	orchis::assert_eq(::pipe(p), 0);
+	const int err = anydim::probe_zip(p[0], anydim::Options {},
+					  [] (const string&,
+					      const anydim::Result&) {});
+	close(p[0]);
+	close(p[1]);
+	orchis::assert_eq(err, ESPIPE);
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "throttle.h"
+
+#include <algorithm>
+#include <thread>
+
+
+Throttle::Bucket::Bucket(double rate)
+    : rate {rate},
+      size {std::max(rate, 1.0)},
+      level {size}
+{}
+
+void Throttle::Bucket::fill(double seconds)
+{
+    level = std::min(size, level + rate * seconds);
+}
+
+/**
+ * The number of seconds until the bucket holds 'need' tokens.
+ */
+double Throttle::Bucket::wait(double need) const
+{
+    if (!rate || level >= need) return 0;
+    return (need - level) / rate;
+}
+
+Throttle::Throttle(double octets, double files)
+    : then {clock::now()},
+      octets {octets},
+      files {files}
+{}
+
+/**
+ * Wait until we may open another file, and take it from the budget.
+ */
+void Throttle::open()
+{
+    std::unique_lock<std::mutex> lock {mutex};
+    while (true) {
+	fill();
+	const double dt = std::max(octets.wait(0), files.wait(1));
+	if (!dt) break;
+
+	lock.unlock();
+	std::this_thread::sleep_for(std::chrono::duration<double>(dt));
+	lock.lock();
+    }
+    files.level--;
+}
+
+/**
+ * Wait until we may read 'n' octets, and take them from the budget.
+ */
+void Throttle::read(size_t n)
+{
+    std::unique_lock<std::mutex> lock {mutex};
+    while (true) {
+	fill();
+	const double dt = octets.wait(std::min(double(n), octets.size));
+	if (!dt) break;
+
+	lock.unlock();
+	std::this_thread::sleep_for(std::chrono::duration<double>(dt));
+	lock.lock();
+    }
+    octets.level -= n;
+}
+
+/**
+ * Give back 'n' octets which read() took, but which weren't read.
+ */
+void Throttle::unread(size_t n)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    fill();
+    octets.level = std::min(octets.size, octets.level + n);
+}
+
+void Throttle::fill()
+{
+    const auto now = clock::now();
+    const double dt = std::chrono::duration<double>(now - then).count();
+    octets.fill(dt);
+    files.fill(dt);
+    then = now;
+}
+
+
+void Throttled::push(const std::string& file)
+{
+    throttle.open();
+    batch->push(file);
+}
@@ -0,0 +1,84 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_THROTTLE_H
+#define ANYDIM_THROTTLE_H
+
+#include "batch.h"
+#include "anydim.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+/**
+ * A budget for I/O: at most so many octets read, and so many files
+ * opened, per second.  Either rate may be zero, meaning no limit.
+ *
+ * It's a pair of token buckets, each holding a second's worth of
+ * tokens (but at least one), shared by all threads.  open() waits
+ * until both buckets are non-empty and takes a file.  read() waits
+ * until there are octets for the read (or a full bucket, for a read
+ * larger than that) and takes them before the read is made; unread()
+ * gives back what a short read didn't use.  So there may be a burst
+ * of a second's worth of I/O at the start, but over time the rates
+ * hold.
+ *
+ * It's the anydim::Budget of the probes; the files are for the
+ * callers to take before they open them.
+ */
+class Throttle final : public anydim::Budget {
+public:
+    Throttle(double octets, double files);
+    Throttle(const Throttle&) = delete;
+    Throttle& operator= (const Throttle&) = delete;
+
+    void open();
+    void read(size_t n) override;
+    void unread(size_t n) override;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Bucket {
+	explicit Bucket(double rate);
+	void fill(double seconds);
+	double wait(double need) const;
+
+	const double rate;
+	const double size;
+	double level;
+    };
+
+    std::mutex mutex;
+    clock::time_point then;
+    Bucket octets;
+    Bucket files;
+
+    void fill();
+};
+
+/**
+ * A Batch which pushes onto another Batch, but only as fast as a
+ * Throttle allows files to be opened.  This is for a Batch which
+ * opens a file as soon as it's pushed, like the Uring.
+ */
+class Throttled final : public Batch {
+public:
+    Throttled(std::unique_ptr<Batch> batch, Throttle& throttle)
+	: batch {std::move(batch)},
+	  throttle {throttle}
+    {}
+
+    void push(const std::string& file) override;
+    bool join() override { return batch->join(); }
+
+private:
+    const std::unique_ptr<Batch> batch;
+    Throttle& throttle;
+};
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "thumb.h"
+#include "png.h"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using anydim::Result;
+
+
+namespace {
+
+    /**
+     * MD5 (RFC 1321), as a hex string.  It's only for naming
+     * thumbnails, so simple is more important than fast.
+     */
+    std::string md5(const std::string& s)
+    {
+	static const uint32_t k[64] = {
+	    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+	    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+	    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+	    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+	    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+	    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+	    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+	    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+	    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+	};
+	static const unsigned r[16] = {
+	    7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21,
+	};
+
+	std::string m = s;
+	m += '\x80';
+	while (m.size() % 64 != 56) m += '\0';
+	const uint64_t bits = uint64_t(s.size()) * 8;
+	for (unsigned i=0; i<8; i++) m += char(bits >> 8*i);
+
+	uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	for (size_t n=0; n < m.size(); n += 64) {
+	    uint32_t w[16];
+	    for (unsigned i=0; i<16; i++) {
+		const auto p = reinterpret_cast<const uint8_t*>(&m[n + 4*i]);
+		w[i] = p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24;
+	    }
+	    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+	    for (unsigned i=0; i<64; i++) {
+		uint32_t f;
+		unsigned g;
+		switch (i / 16) {
+		case 0: f = (b & c) | (~b & d); g = i; break;
+		case 1: f = (d & b) | (~d & c); g = 5*i + 1; break;
+		case 2: f = b ^ c ^ d; g = 3*i + 5; break;
+		default: f = c ^ (b | ~d); g = 7*i; break;
+		}
+		const uint32_t x = a + f + k[i] + w[g % 16];
+		const unsigned sh = r[i / 16 * 4 + i % 4];
+		a = d;
+		d = c;
+		c = b;
+		b += x << sh | x >> (32 - sh);
+	    }
+	    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	}
+
+	static const char hex[] = "0123456789abcdef";
+	std::string digest;
+	for (uint32_t x : h) {
+	    for (unsigned i=0; i<4; i++) {
+		const unsigned octet = x >> 8*i & 0xff;
+		digest += hex[octet >> 4];
+		digest += hex[octet & 0xf];
+	    }
+	}
+	return digest;
+    }
+
+    /**
+     * 'path' made absolute, without "." and ".." components and
+     * repeated slashes.  Symbolic links are left alone, like a file
+     * manager would.
+     */
+    std::string absolute(const std::string& path)
+    {
+	std::string s;
+	if (path.empty() || path[0]!='/') {
+	    char buf[4096];
+	    if (!getcwd(buf, sizeof buf)) return "";
+	    s = buf;
+	}
+	s += '/';
+	s += path;
+
+	std::vector<std::string> v;
+	std::string::size_type a = 0;
+	while (a < s.size()) {
+	    auto b = std::min(s.find('/', a), s.size());
+	    const std::string name = s.substr(a, b-a);
+	    if (name=="..") {
+		if (!v.empty()) v.pop_back();
+	    }
+	    else if (!name.empty() && name!=".") {
+		v.push_back(name);
+	    }
+	    a = b + 1;
+	}
+
+	std::string t;
+	for (const auto& name : v) t += '/' + name;
+	return t.empty() ? "/" : t;
+    }
+
+    /* The MIME types we'd also decide on ourselves.
+     */
+    const char* const mimes[] = {
+	"image/jpeg",
+	"image/png",
+	"image/x-portable-bitmap",
+	"image/x-portable-graymap",
+	"image/x-portable-pixmap",
+    };
+
+    const char* mime(const std::string& s)
+    {
+	for (const char* m : mimes) {
+	    if (s==m) return m;
+	}
+	return nullptr;
+    }
+
+    bool number(const std::string& s, unsigned long long& n)
+    {
+	if (s.empty() || !std::isdigit(static_cast<unsigned char>(s[0]))) {
+	    return false;
+	}
+	char* end;
+	errno = 0;
+	n = std::strtoull(s.c_str(), &end, 10);
+	return !*end && !errno;
+    }
+
+    /**
+     * The start of the file 'path', enough for the chunks before the
+     * image data of a normal thumbnail.
+     */
+    bool slurp(const std::string& path, std::vector<uint8_t>& v)
+    {
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd==-1) return false;
+	v.resize(anydim::thumbnail_head);
+	size_t n = 0;
+	while (n < v.size()) {
+	    const ssize_t rc = read(fd, v.data() + n, v.size() - n);
+	    if (rc==-1 && errno==EINTR) continue;
+	    if (rc <= 0) break;
+	    n += rc;
+	}
+	close(fd);
+	v.resize(n);
+	return n;
+    }
+
+    std::string cache_dir()
+    {
+	const char* xdg = std::getenv("XDG_CACHE_HOME");
+	if (xdg && *xdg) return std::string(xdg) + "/thumbnails";
+	const char* home = std::getenv("HOME");
+	if (home && *home) return std::string(home) + "/.cache/thumbnails";
+	return "";
+    }
+
+    /**
+     * Take the result from the thumbnail [a, b) for 'uri', if it's
+     * valid for the original.
+     */
+    bool decide(const uint8_t* a, const uint8_t* b, const std::string& uri,
+		const anydim::Cache::Key& key, bool use_exif, Result& res)
+    {
+	anydim::PngDim thumb;
+	thumb.feed(a, b);
+	if (thumb.undecided() || thumb.bad()) return false;
+
+	std::map<std::string, std::string> text;
+	try {
+	    text = png::text(png::chunks(a, b));
+	}
+	catch (const png::Error&) {
+	    return false;
+	}
+
+	unsigned long long mtime, size, width, height;
+	if (text["Thumb::URI"]!=uri) return false;
+	if (!number(text["Thumb::MTime"], mtime)) return false;
+	if (mtime!=uint64_t(key.mtime / 1000000000)) return false;
+	if (text.count("Thumb::Size") &&
+	    (!number(text["Thumb::Size"], size) || size!=key.size)) {
+	    return false;
+	}
+	if (!number(text["Thumb::Image::Width"], width) ||
+	    !number(text["Thumb::Image::Height"], height) ||
+	    !width || !height || width > ~0u || height > ~0u) {
+	    return false;
+	}
+	const char* const type = mime(text["Thumb::Mime"]);
+	if (!type) return false;
+
+	if (use_exif && !std::strcmp(type, "image/jpeg") && width!=height) {
+	    if (thumb.width==thumb.height) return false;
+	    if ((thumb.width > thumb.height) != (width > height)) {
+		std::swap(width, height);
+	    }
+	}
+
+	res = Result {};
+	res.mime = type;
+	res.width = width;
+	res.height = height;
+	return true;
+    }
+}
+
+
+/**
+ * The file:// URI for 'path', escaped like GLib does it.
+ */
+std::string anydim::file_uri(const std::string& path)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    static const char safe[] = "!$&'()*+,-./:=@_~";
+
+    std::string uri = "file://";
+    for (char ch : absolute(path)) {
+	const unsigned char c = ch;
+	if (std::isalnum(c) || std::strchr(safe, c)) {
+	    uri += ch;
+	}
+	else {
+	    uri += '%';
+	    uri += hex[c >> 4];
+	    uri += hex[c & 0xf];
+	}
+    }
+    return uri;
+}
+
+/**
+ * The file name of the thumbnail for 'uri', in any of the size
+ * directories.
+ */
+std::string anydim::thumbnail_name(const std::string& uri)
+{
+    return md5(uri) + ".png";
+}
+
+/**
+ * The smaller thumbnails are tried first, since they are cheaper to
+ * read and all say the same thing.
+ */
+std::vector<std::string> anydim::thumbnail_files(const std::string& uri)
+{
+    std::vector<std::string> v;
+    const std::string dir = cache_dir();
+    if (dir.empty()) return v;
+
+    const std::string name = thumbnail_name(uri);
+    for (const char* size : {"normal", "large", "x-large", "xx-large"}) {
+	v.push_back(dir + '/' + size + '/' + name);
+    }
+    return v;
+}
+
+bool anydim::get_thumbnail(const uint8_t* a, const uint8_t* b,
+			   const std::string& uri, const Cache::Key& key,
+			   bool use_exif, Result& res)
+{
+    return decide(a, b, uri, key, use_exif, res);
+}
+
+bool anydim::get_thumbnail(const char* path, const Cache::Key& key,
+			   bool use_exif, Result& res)
+{
+    const std::string uri = file_uri(path);
+    for (const std::string& file : thumbnail_files(uri)) {
+	std::vector<uint8_t> v;
+	if (!slurp(file, v)) continue;
+	if (decide(v.data(), v.data() + v.size(), uri, key, use_exif, res)) {
+	    return true;
+	}
+    }
+    return false;
+}
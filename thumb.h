@@ -0,0 +1,61 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_THUMB_H
+#define ANYDIM_THUMB_H
+
+#include "anydim.h"
+#include "cache.h"
+
+#include <string>
+#include <vector>
+
+namespace anydim {
+
+    /**
+     * The result for a file, from its thumbnail in the freedesktop.org
+     * thumbnail cache (~/.cache/thumbnails, or under $XDG_CACHE_HOME)
+     * which desktops and file managers keep.  The thumbnail is a small
+     * PNG named by the MD5 of the original's file URI, with tEXt chunks
+     * like
+     *
+     *   Thumb::URI            file:///home/jens/photos/me.png
+     *   Thumb::MTime          1612345678
+     *   Thumb::Mime           image/png
+     *   Thumb::Image::Width   4000
+     *   Thumb::Image::Height  3000
+     *
+     * If the URI and mtime (and Thumb::Size, if it's there) match the
+     * original according to 'key', the thumbnail is good enough, and
+     * the original needn't be opened.
+     *
+     * Only MIME types we can decode ourselves are trusted.  The
+     * Image::Width and Height don't say if Exif orientation was
+     * applied; for a JPEG with 'use_exif', they are ordered to match
+     * the thumbnail's own, which is rotated like the image is shown.
+     * A square thumbnail doesn't tell, so it's not used then.
+     */
+    bool get_thumbnail(const char* path, const Cache::Key& key,
+		       bool use_exif, Result& res);
+
+    /**
+     * The same in steps, for callers which do their own I/O: the
+     * thumbnails which may exist for 'uri', in the order to try them,
+     * and the result from the first 'thumbnail_head' octets (or all,
+     * if it's shorter) of one of them, [a, b).
+     */
+    std::vector<std::string> thumbnail_files(const std::string& uri);
+    bool get_thumbnail(const uint8_t* a, const uint8_t* b,
+		       const std::string& uri, const Cache::Key& key,
+		       bool use_exif, Result& res);
+
+    const size_t thumbnail_head = 64 * 1024;
+
+    std::string file_uri(const std::string& path);
+    std::string thumbnail_name(const std::string& uri);
+}
+
+#endif
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019 Jrgen Grahn
+ * Copyright (c) 2019 Jörgen Grahn
  * All rights reserved.
  *
  */
@@ -0,0 +1,710 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "uring.h"
+#include "anydim.h"
+#include "http.h"
+#include "cache.h"
+#include "thumb.h"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+
+namespace {
+
+    enum Op { OPEN, STATX, READ, TIMEOUT, THUMB_OPEN, THUMB_READ };
+    const uint64_t opmask = 7;
+
+    /* The most operations in flight on one file at a time: the open
+     * and the statx, or a read and the statx, each with its timeout.
+     */
+    const unsigned slot_ops = 4;
+
+    /* What IORING_SETUP_CQSIZE is asked for, so that the completion
+     * queue can't overflow.
+     */
+    int setup(unsigned entries, io_uring_params& p)
+    {
+	p.flags |= IORING_SETUP_CQSIZE;
+	p.cq_entries = entries;
+	return syscall(__NR_io_uring_setup, entries, &p);
+    }
+
+    int enter(int fd, unsigned to_submit, unsigned min_complete)
+    {
+	const unsigned flags = min_complete? IORING_ENTER_GETEVENTS: 0;
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, nullptr, 0);
+    }
+
+    /**
+     * True if the kernel supports all the operations we need. They
+     * came in Linux 5.6, but the probe came in 5.6 too, so a failing
+     * probe is also a no.
+     */
+    bool supported(int fd)
+    {
+	const size_t len = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+	std::unique_ptr<char[]> mem {new char[len]()};
+	auto probe = reinterpret_cast<io_uring_probe*>(mem.get());
+	if (syscall(__NR_io_uring_register, fd,
+		    IORING_REGISTER_PROBE, probe, 256)) return false;
+
+	for (unsigned op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ,
+			    IORING_OP_LINK_TIMEOUT}) {
+	    if (op > probe->last_op) return false;
+	    if (!(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+	}
+	return true;
+    }
+
+    template <class T>
+    T* at(void* base, unsigned offset)
+    {
+	return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    anydim::Cache::Key key_of(const struct statx& stx, bool exif)
+    {
+	return {makedev(stx.stx_dev_major, stx.stx_dev_minor),
+		stx.stx_ino, stx.stx_size,
+		stx.stx_mtime.tv_sec * 1000000000LL + stx.stx_mtime.tv_nsec,
+		exif};
+    }
+}
+
+
+/**
+ * The submission and completion queues shared with the kernel, and
+ * the bare minimum of liburing to use them.
+ */
+struct Uring::Ring {
+    explicit Ring(unsigned entries);
+    ~Ring() { unmap(); }
+    void unmap();
+
+    io_uring_sqe* sqe();
+    bool submit(unsigned min_complete);
+    bool ready() const;
+    void wait();
+
+    template <class F>
+    unsigned reap(F f);
+
+    int fd;
+    io_uring_params p {};
+
+    void* sq = MAP_FAILED;
+    void* cq = MAP_FAILED;
+    size_t sqlen;
+    size_t cqlen;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+
+    unsigned tail = 0;
+    unsigned pending = 0;
+};
+
+Uring::Ring::Ring(unsigned entries)
+{
+    fd = setup(entries, p);
+    if (fd==-1) throw Unavailable {};
+    if (!supported(fd)) {
+	close(fd);
+	throw Unavailable {};
+    }
+
+    sqlen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqlen = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+	sqlen = cqlen = std::max(sqlen, cqlen);
+    }
+
+    sq = mmap(nullptr, sqlen, PROT_READ | PROT_WRITE,
+	      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cq = (p.features & IORING_FEAT_SINGLE_MMAP)
+	? sq
+	: mmap(nullptr, cqlen, PROT_READ | PROT_WRITE,
+	       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqes = static_cast<io_uring_sqe*>(mmap(nullptr, p.sq_entries * sizeof(io_uring_sqe),
+					    PROT_READ | PROT_WRITE,
+					    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+    if (sq==MAP_FAILED || cq==MAP_FAILED || sqes==MAP_FAILED) {
+	unmap();
+	throw Unavailable {};
+    }
+    tail = *at<unsigned>(sq, p.sq_off.tail);
+}
+
+void Uring::Ring::unmap()
+{
+    if (sqes!=MAP_FAILED) munmap(sqes, p.sq_entries * sizeof(io_uring_sqe));
+    if (cq!=MAP_FAILED && cq!=sq) munmap(cq, cqlen);
+    if (sq!=MAP_FAILED) munmap(sq, sqlen);
+    sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    cq = sq = MAP_FAILED;
+    if (fd!=-1) close(fd);
+    fd = -1;
+}
+
+/**
+ * A fresh submission queue entry.  The queues are as large as the
+ * number of operations we let be in flight (see Uring::push), and an
+ * entry not yet submitted is one of those, so there's always room.
+ */
+io_uring_sqe* Uring::Ring::sqe()
+{
+    const unsigned mask = *at<unsigned>(sq, p.sq_off.ring_mask);
+    const unsigned n = tail & mask;
+    at<unsigned>(sq, p.sq_off.array)[n] = n;
+    io_uring_sqe* const e = &sqes[n];
+    std::memset(e, 0, sizeof *e);
+    tail++;
+    pending++;
+    return e;
+}
+
+/**
+ * Submit what's in the submission queue, and wait for at least
+ * 'min_complete' completions.  Returns false if the kernel can't take
+ * them right now (EAGAIN, or EBUSY if the completion queue is full);
+ * then the completion queue must be reaped before trying again.
+ */
+bool Uring::Ring::submit(unsigned min_complete)
+{
+    __atomic_store_n(at<unsigned>(sq, p.sq_off.tail), tail, __ATOMIC_RELEASE);
+    while (true) {
+	const int n = enter(fd, pending, min_complete);
+	if (n >= 0) {
+	    pending -= std::min(unsigned(n), pending);
+	    return true;
+	}
+	if (errno==EAGAIN || errno==EBUSY) return false;
+	if (errno!=EINTR) {
+	    throw std::system_error {errno, std::generic_category()};
+	}
+    }
+}
+
+/**
+ * True if there are completion queue entries to reap.
+ */
+bool Uring::Ring::ready() const
+{
+    const unsigned head = *at<unsigned>(cq, p.cq_off.head);
+    return head!=__atomic_load_n(at<unsigned>(cq, p.cq_off.tail), __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Wait for a completion, without submitting anything.
+ */
+void Uring::Ring::wait()
+{
+    while (enter(fd, 0, 1)==-1) {
+	if (errno==EAGAIN || errno==EBUSY) return;
+	if (errno!=EINTR) {
+	    throw std::system_error {errno, std::generic_category()};
+	}
+    }
+}
+
+/**
+ * Call f(user_data, res) for each completion queue entry available,
+ * and return the number of entries.
+ */
+template <class F>
+unsigned Uring::Ring::reap(F f)
+{
+    unsigned* const headp = at<unsigned>(cq, p.cq_off.head);
+    const unsigned mask = *at<unsigned>(cq, p.cq_off.ring_mask);
+    const auto cqes = at<io_uring_cqe>(cq, p.cq_off.cqes);
+
+    unsigned head = *headp;
+    const unsigned tail = __atomic_load_n(at<unsigned>(cq, p.cq_off.tail), __ATOMIC_ACQUIRE);
+    unsigned n = 0;
+    while (head!=tail) {
+	const io_uring_cqe& e = cqes[head & mask];
+	const auto data = e.user_data;
+	const int res = e.res;
+	head++;
+	__atomic_store_n(headp, head, __ATOMIC_RELEASE);
+	f(data, res);
+	n++;
+    }
+    return n;
+}
+
+
+/**
+ * A file in the batch, from being pushed until its result is written.
+ * Its address is the user_data of its operations, with the Op in the
+ * low bits.
+ */
+struct alignas(opmask + 1) Uring::Slot {
+    Slot(const std::string& file, const anydim::Options& options)
+	: file {file},
+	  dim {options.use_exif, options.max_octets, options.memo}
+    {}
+
+    const std::string file;
+    anydim::AnyDim dim;
+    anydim::Result res;
+    int flags = O_RDONLY | O_CLOEXEC;
+    int fd = -1;
+    uint64_t size = std::numeric_limits<uint64_t>::max();
+    uint64_t offset = 0;
+    size_t len = 0;
+    unsigned ops = 0;
+    bool done = false;
+    bool timedout = false;
+    bool abandoned = false;
+    bool cached = false;
+    __kernel_timespec deadline;
+    struct statx stx;
+    uint8_t buf[4096];
+
+    std::string uri;
+    std::vector<std::string> thumbs;
+    unsigned thumb = 0;
+    int tfd = -1;
+    std::unique_ptr<uint8_t[]> tbuf;
+};
+
+
+constexpr unsigned Uring::max_depth;
+
+Uring::Uring(std::ostream& os, const Report& report,
+	     const anydim::Options& options, unsigned depth, bool ordered)
+    : os {os},
+      report {report},
+      options {options},
+      depth {std::max(1u, std::min(depth, max_depth))},
+      ordered {ordered},
+      ring {new Ring {2 * slot_ops * this->depth}}
+{}
+
+/**
+ * Abandoned slots may still be written to by the kernel, so they're
+ * never freed.
+ */
+Uring::~Uring()
+{
+    join();
+    for (auto& p : orphans) p.release();
+}
+
+/**
+ * Submit the open and statx of 'file', first waiting for completions
+ * if there are already too many files in flight.  Abandoned files
+ * count too, by their operations: the ring has room for twice what
+ * the active files may have in flight, and no more.  With a cache, the
+ * statx goes first, alone, and the file is opened only if it's not
+ * found in the cache (or its extended attribute).
+ *
+ * An http:// URL is probed right here, with plain sockets; the ring
+ * waits meanwhile.
+ */
+void Uring::push(const std::string& file)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+
+    while (active >= depth || slots.size() >= 2*depth ||
+	   inflight + slot_ops > ring->p.cq_entries) {
+	reap(true);
+    }
+
+    slots.emplace_back(new Slot {file, options});
+    Slot& slot = *slots.back();
+    active++;
+
+    if (options.timeout) {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	const long long ns = now.tv_nsec + options.timeout % 1000 * 1000000LL;
+	slot.deadline.tv_sec = now.tv_sec + options.timeout / 1000 + ns / 1000000000;
+	slot.deadline.tv_nsec = ns % 1000000000;
+    }
+
+    if (anydim::Http::url(file)) {
+	slot.res = http.probe(file, options);
+	slot.cached = true;
+	finish(slot);
+	write();
+	return;
+    }
+
+    if (options.gentle) slot.flags |= O_NOATIME;
+    const bool recall = options.cache || options.xattr || options.thumbnails;
+    if (!recall) open(slot);
+
+    io_uring_sqe* const e = sqe(slot);
+    e->opcode = IORING_OP_STATX;
+    e->fd = AT_FDCWD;
+    e->addr = reinterpret_cast<uintptr_t>(slot.file.c_str());
+    e->len = recall ? STATX_BASIC_STATS : STATX_SIZE;
+    e->off = reinterpret_cast<uintptr_t>(&slot.stx);
+    e->user_data = reinterpret_cast<uintptr_t>(&slot) | STATX;
+
+    /* if the kernel won't take them yet, they're submitted after
+     * the next reap */
+    if (ring->pending >= depth/4) ring->submit(0);
+    reap(false);
+}
+
+bool Uring::join()
+{
+    std::lock_guard<std::mutex> lock {mutex};
+
+    while (active) reap(true);
+    write();
+    return ok;
+}
+
+/**
+ * Handle the completions, and write the results which are ready.  If
+ * 'wait', first submit what's pending and wait for at least one
+ * completion.  If the kernel won't take the submissions yet, this
+ * reaps what it can (or waits for something to reap, if anything is
+ * in flight) and leaves them for the next call.
+ */
+void Uring::reap(bool wait)
+{
+    if (wait && !ring->submit(1) && !ring->ready() &&
+	inflight > ring->pending) {
+	ring->wait();
+    }
+
+    ring->reap([this] (uint64_t data, int res) {
+		   auto& slot = *reinterpret_cast<Slot*>(data & ~opmask);
+		   complete(slot, data & opmask, res);
+	       });
+    write();
+}
+
+/**
+ * A submission queue entry for an operation on 'slot', for the caller
+ * to fill in.  With a timeout, it's linked to a timeout at the slot's
+ * deadline, which cancels it if it's still in progress by then.
+ */
+io_uring_sqe* Uring::sqe(Slot& slot)
+{
+    slot.ops++;
+    inflight++;
+    if (!options.timeout) return ring->sqe();
+
+    io_uring_sqe* const e = ring->sqe();
+    e->flags |= IOSQE_IO_LINK;
+
+    io_uring_sqe* const t = ring->sqe();
+    t->opcode = IORING_OP_LINK_TIMEOUT;
+    t->addr = reinterpret_cast<uintptr_t>(&slot.deadline);
+    t->len = 1;
+    t->timeout_flags = IORING_TIMEOUT_ABS;
+    t->user_data = reinterpret_cast<uintptr_t>(&slot) | TIMEOUT;
+    slot.ops++;
+    inflight++;
+
+    return e;
+}
+
+void Uring::open(Slot& slot)
+{
+    io_uring_sqe* const e = sqe(slot);
+    e->opcode = IORING_OP_OPENAT;
+    e->fd = AT_FDCWD;
+    e->addr = reinterpret_cast<uintptr_t>(slot.file.c_str());
+    e->open_flags = slot.flags;
+    e->user_data = reinterpret_cast<uintptr_t>(&slot) | OPEN;
+}
+
+/**
+ * Operation 'op' on 'slot' completed with result 'res'.
+ */
+void Uring::complete(Slot& slot, unsigned op, int res)
+{
+    slot.ops--;
+    inflight--;
+    if (slot.abandoned) {
+	if (op==OPEN && res >= 0) slot.fd = res;
+	if (op==THUMB_OPEN && res >= 0) slot.tfd = res;
+	if (!slot.ops) release(slot);
+	return;
+    }
+
+    switch (op) {
+    case OPEN:
+	if (res==-EPERM && (slot.flags & O_NOATIME) && !slot.timedout) {
+	    slot.flags &= ~O_NOATIME;
+	    open(slot);
+	}
+	else if (res < 0) {
+	    slot.res.error = -res;
+	}
+	else {
+	    slot.fd = res;
+	    if (options.gentle) posix_fadvise(slot.fd, 0, 0, POSIX_FADV_RANDOM);
+	    read(slot);
+	}
+	break;
+
+    case STATX:
+	if (res==0) slot.size = slot.stx.stx_size;
+	if (options.cache || options.xattr || options.thumbnails) {
+	    lookup(slot, res==0);
+	}
+	break;
+
+    case TIMEOUT:
+	if (res==-ETIME) {
+	    slot.timedout = true;
+	    if (slot.ops) {
+		abandon(slot);
+		return;
+	    }
+	}
+	break;
+
+    case READ:
+	if (options.budget && res < int(slot.len)) {
+	    options.budget->unread(slot.len - std::max(res, 0));
+	}
+	if (res < 0) {
+	    slot.res.error = -res;
+	    break;
+	}
+	if (res==0) break;
+	slot.res.tally(slot.offset, res);
+	slot.dim.feed(slot.buf, slot.buf + res);
+	slot.offset += res;
+	if (slot.dim.undecided()) {
+	    const size_t skip = slot.dim.skippable();
+	    slot.dim.skip(skip);
+	    slot.offset += skip;
+	    read(slot);
+	}
+	break;
+
+    case THUMB_OPEN:
+	if (res < 0) {
+	    slot.thumb++;
+	    thumbnail(slot);
+	    break;
+	}
+	slot.tfd = res;
+	slot.tbuf.reset(new uint8_t[anydim::thumbnail_head]);
+	{
+	    io_uring_sqe* e = sqe(slot);
+	    e->opcode = IORING_OP_READ;
+	    e->fd = slot.tfd;
+	    e->addr = reinterpret_cast<uintptr_t>(slot.tbuf.get());
+	    e->len = anydim::thumbnail_head;
+	    e->off = 0;
+	    e->user_data = reinterpret_cast<uintptr_t>(&slot) | THUMB_READ;
+	}
+	break;
+
+    case THUMB_READ:
+	close(slot.tfd);
+	slot.tfd = -1;
+	slot.cached = res > 0 &&
+	    anydim::get_thumbnail(slot.tbuf.get(), slot.tbuf.get() + res,
+				  slot.uri, key_of(slot.stx, options.use_exif),
+				  options.use_exif, slot.res);
+	slot.tbuf.reset();
+	if (!slot.cached) {
+	    slot.thumb++;
+	    thumbnail(slot);
+	}
+	break;
+    }
+
+    if (!slot.ops) finish(slot);
+}
+
+/**
+ * Look the file up in the cache or its extended attribute, if
+ * 'found' by statx, and if it's not there, try its thumbnails or
+ * open it.  There's no io_uring getxattr in the kernels we support,
+ * so that's a plain system call.
+ */
+void Uring::lookup(Slot& slot, bool found)
+{
+    if (!found || !S_ISREG(slot.stx.stx_mode)) {
+	if (!slot.timedout) open(slot);
+	return;
+    }
+
+    const anydim::Cache::Key key = key_of(slot.stx, options.use_exif);
+    slot.cached = options.cache && options.cache->find(key, slot.res);
+    if (!slot.cached && options.xattr) {
+	slot.cached = anydim::get_xattr(slot.file.c_str(), key, slot.res);
+	if (slot.cached && options.cache) options.cache->insert(key, slot.res);
+    }
+    if (slot.cached) return;
+
+    if (options.thumbnails) {
+	slot.uri = anydim::file_uri(slot.file);
+	slot.thumbs = anydim::thumbnail_files(slot.uri);
+    }
+    thumbnail(slot);
+}
+
+/**
+ * Try the next of the slot's thumbnails, or if there are no more,
+ * open the file itself.
+ */
+void Uring::thumbnail(Slot& slot)
+{
+    if (slot.timedout) return;
+    if (slot.thumb >= slot.thumbs.size()) {
+	open(slot);
+	return;
+    }
+
+    io_uring_sqe* const e = sqe(slot);
+    e->opcode = IORING_OP_OPENAT;
+    e->fd = AT_FDCWD;
+    e->addr = reinterpret_cast<uintptr_t>(slot.thumbs[slot.thumb].c_str());
+    e->open_flags = O_RDONLY | O_CLOEXEC;
+    e->user_data = reinterpret_cast<uintptr_t>(&slot) | THUMB_OPEN;
+}
+
+/**
+ * Submit the next read for 'slot', unless we know we're at the end of
+ * the file. In that case we may not know yet if the statx has
+ * completed, but it doesn't matter much: the read will return 0.
+ */
+void Uring::read(Slot& slot)
+{
+    if (slot.offset >= slot.size || slot.timedout) return;
+
+    const size_t want = slot.dim.want();
+    slot.len = want? std::min(want, sizeof slot.buf): sizeof slot.buf;
+    if (options.budget) options.budget->read(slot.len);
+
+    io_uring_sqe* e = sqe(slot);
+    e->opcode = IORING_OP_READ;
+    e->fd = slot.fd;
+    e->addr = reinterpret_cast<uintptr_t>(slot.buf);
+    e->len = slot.len;
+    e->off = slot.offset;
+    e->user_data = reinterpret_cast<uintptr_t>(&slot) | READ;
+}
+
+/**
+ * All operations on 'slot' are done, so it's either decided, at its
+ * end, or failed.
+ */
+void Uring::finish(Slot& slot)
+{
+    slot.done = true;
+    active--;
+    if (slot.cached) return;
+
+    if (slot.timedout && slot.dim.undecided()) slot.res.error = ETIMEDOUT;
+    if (slot.dim.undecided()) slot.dim.eof();
+    slot.res.decided(slot.dim);
+
+    struct stat st;
+    if ((options.cache || options.xattr) &&
+	slot.fd!=-1 && fstat(slot.fd, &st)==0 && S_ISREG(st.st_mode)) {
+	const anydim::Cache::Key key {st, options.use_exif};
+	if (options.cache) options.cache->insert(key, slot.res);
+	if (options.xattr) anydim::set_xattr(slot.fd, key, slot.res);
+    }
+
+    if (slot.fd!=-1) {
+	if (options.gentle) {
+	    posix_fadvise(slot.fd, 0, slot.res.offset, POSIX_FADV_DONTNEED);
+	}
+	close(slot.fd);
+    }
+    slot.fd = -1;
+}
+
+/**
+ * The deadline has passed for 'slot', but an operation on it is still
+ * in progress, and may stay so, e.g. an open or read in
+ * uninterruptible sleep on hung storage.  Report it as timed out now,
+ * and let another file take its place, but keep it until the kernel
+ * is done with it.
+ */
+void Uring::abandon(Slot& slot)
+{
+    slot.abandoned = true;
+    slot.done = true;
+    slot.res.error = ETIMEDOUT;
+    active--;
+}
+
+/**
+ * The last operation on the abandoned 'slot' has completed after all.
+ */
+void Uring::release(Slot& slot)
+{
+    if (slot.fd!=-1) close(slot.fd);
+    if (slot.tfd!=-1) close(slot.tfd);
+    slot.fd = -1;
+    slot.tfd = -1;
+    auto it = std::find_if(begin(orphans), end(orphans),
+			   [&slot] (const std::unique_ptr<Slot>& p) {
+			       return p.get()==&slot;
+			   });
+    if (it!=end(orphans)) orphans.erase(it);
+}
+
+/**
+ * Forget a slot which has been written, unless it's abandoned and
+ * the kernel isn't done with it.
+ */
+void Uring::drop(std::unique_ptr<Slot>& slot)
+{
+    if (slot->ops) orphans.push_back(std::move(slot));
+    slot.reset();
+}
+
+/**
+ * Write the results which are ready, and forget about those files.
+ */
+void Uring::write()
+{
+    auto print = [this] (const Slot& slot) {
+		     if (!report(os, slot.file, slot.res)) ok = false;
+		 };
+
+    if (ordered) {
+	while (!slots.empty() && slots.front()->done) {
+	    print(*slots.front());
+	    drop(slots.front());
+	    slots.pop_front();
+	}
+	return;
+    }
+
+    auto it = std::stable_partition(begin(slots), end(slots),
+				    [] (const std::unique_ptr<Slot>& p) {
+					return !p->done;
+				    });
+    std::for_each(it, end(slots),
+		  [&] (std::unique_ptr<Slot>& p) {
+		      print(*p);
+		      drop(p);
+		  });
+    slots.erase(it, end(slots));
+}
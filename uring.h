@@ -0,0 +1,113 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_URING_H
+#define ANYDIM_URING_H
+
+#include "batch.h"
+#include "anydim.h"
+#include "http.h"
+
+#include <iosfwd>
+#include <string>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+
+struct io_uring_sqe;
+
+/**
+ * A Batch which probes many files at once, in a single thread, using
+ * Linux io_uring.
+ *
+ * For each file, the open, the statx (for the file size) and the
+ * first 4096-octet read are submitted together with those of hundreds
+ * of other files, and the results are fed into one AnyDim per file as
+ * they complete.  Only files which are still undecided after that get
+ * another read.
+ *
+ * With gentle Options, the files are opened with O_NOATIME if
+ * possible, and the same fadvise(2) calls are made as for probe().
+ * With a timeout, each operation is linked to a timeout at the file's
+ * deadline, so a hung open or read is cancelled by the kernel.  One
+ * which can't be cancelled (in uninterruptible sleep, on hung storage)
+ * is abandoned: the file is reported as timed out and its place is
+ * taken by another, but its memory is kept until the kernel is done
+ * with it.  The ring has room for only so many abandoned operations,
+ * though (as many as the active files may have); beyond that, pushing
+ * waits for them, so the completion queue can never overflow.
+ * With a cache or xattrs, files found there are never opened, and
+ * with thumbnails, the thumbnails are read through the ring too.  Only
+ * what's found in xattrs is added to the cache; a thumbnail's result
+ * is a good enough guess, but not worth keeping.
+ * http:// URLs are probed one at a time, outside the ring.  With
+ * a budget, the reads are taken from it as they are submitted.
+ *
+ * The results are written by a Report function, either in the order
+ * the files were pushed or (if not 'ordered') as they complete.
+ *
+ * The constructor throws Uring::Unavailable if the kernel doesn't
+ * support io_uring, or doesn't let us use it; in that case there's
+ * always the Pool.
+ */
+class Uring final : public Batch {
+public:
+    using Report = std::function<bool(std::ostream&,
+				      const std::string& file,
+				      const anydim::Result& res)>;
+
+    class Unavailable {};
+
+    /* The kernel takes at most 32768 submission queue entries, and
+     * the ring needs eight per file in flight.
+     */
+    static constexpr unsigned max_depth = 4096;
+
+    Uring(std::ostream& os, const Report& report,
+	  const anydim::Options& options, unsigned depth, bool ordered);
+    ~Uring();
+    Uring(const Uring&) = delete;
+    Uring& operator= (const Uring&) = delete;
+
+    void push(const std::string& file) override;
+    bool join() override;
+
+private:
+    struct Ring;
+    struct Slot;
+
+    std::ostream& os;
+    const Report report;
+    const anydim::Options options;
+    const unsigned depth;
+    const bool ordered;
+    anydim::Http http;
+
+    std::mutex mutex;
+    std::unique_ptr<Ring> ring;
+    std::deque<std::unique_ptr<Slot>> slots;
+    std::vector<std::unique_ptr<Slot>> orphans;
+    unsigned active = 0;
+    unsigned inflight = 0;
+    bool ok = true;
+
+    io_uring_sqe* sqe(Slot& slot);
+    void open(Slot& slot);
+    void reap(bool wait);
+    void complete(Slot& slot, unsigned op, int res);
+    void lookup(Slot& slot, bool found);
+    void thumbnail(Slot& slot);
+    void read(Slot& slot);
+    void finish(Slot& slot);
+    void abandon(Slot& slot);
+    void release(Slot& slot);
+    void drop(std::unique_ptr<Slot>& slot);
+    void write();
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "walk.h"
+#include "batch.h"
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <cctype>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+
+namespace {
+
+    std::string lower(std::string s)
+    {
+	for (char& ch : s) ch = std::tolower(static_cast<unsigned char>(ch));
+	return s;
+    }
+
+    bool dots(const char* name)
+    {
+	return !std::strcmp(name, ".") || !std::strcmp(name, "..");
+    }
+
+    std::string join(const std::string& dir, const char* name)
+    {
+	if (!dir.empty() && dir.back()=='/') return dir + name;
+	return dir + '/' + name;
+    }
+}
+
+
+/**
+ * Add a comma-separated list of extensions, like "jpg,jpeg,png".
+ */
+void Filter::ext(const std::string& list)
+{
+    std::string::size_type a = 0;
+    while (a <= list.size()) {
+	auto b = std::min(list.find(',', a), list.size());
+	if (b > a) exts.push_back('.' + lower(list.substr(a, b-a)));
+	a = b + 1;
+    }
+}
+
+void Filter::glob(const std::string& pattern)
+{
+    globs.push_back(pattern);
+}
+
+bool Filter::operator() (const char* name) const
+{
+    if (exts.empty() && globs.empty()) return true;
+
+    const char* dot = std::strrchr(name, '.');
+    if (dot) {
+	const std::string ext = lower(dot);
+	if (std::find(begin(exts), end(exts), ext) != end(exts)) return true;
+    }
+
+    for (const auto& glob : globs) {
+	if (!fnmatch(glob.c_str(), name, 0)) return true;
+    }
+    return false;
+}
+
+
+/**
+ * An open directory, closed when no one needs it anymore.
+ */
+struct Walk::Parent {
+    explicit Parent(DIR* dir) : dir {dir} {}
+    Parent(const Parent&) = delete;
+    Parent& operator= (const Parent&) = delete;
+    ~Parent() { closedir(dir); }
+
+    int fd() const { return dirfd(dir); }
+
+    DIR* const dir;
+};
+
+
+size_t Walk::Hash::operator() (const std::pair<dev_t, ino_t>& key) const
+{
+    return std::hash<ino_t>{}(key.second) ^ (std::hash<dev_t>{}(key.first) << 1);
+}
+
+Walk::Walk(Batch& batch, const Filter& filter, unsigned n)
+    : batch {batch},
+      filter {filter},
+      n {n ? n : 1}
+{}
+
+/**
+ * Walk the directory trees 'roots', returning false if any part
+ * of them couldn't be read.
+ */
+bool Walk::walk(const std::vector<std::string>& roots)
+{
+    for (auto i = roots.rbegin(); i != roots.rend(); i++) {
+	dirs.push_back({*i, nullptr});
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i=1; i<n; i++) {
+	threads.emplace_back(&Walk::run, this);
+    }
+    run();
+    for (auto& t : threads) t.join();
+
+    return ok;
+}
+
+/**
+ * The walker thread: read directories from the queue until it's
+ * empty, and no other walker is busy reading a directory (which
+ * might add more).
+ */
+void Walk::run()
+{
+    std::unique_lock<std::mutex> lock {mutex};
+
+    while (true) {
+	work.wait(lock, [this] { return !dirs.empty() || !busy; });
+	if (dirs.empty()) break;
+
+	const Dir dir = std::move(dirs.back());
+	dirs.pop_back();
+	busy++;
+
+	lock.unlock();
+	const bool success = readdir(dir);
+	lock.lock();
+
+	if (!success) ok = false;
+	busy--;
+	work.notify_all();
+    }
+}
+
+/**
+ * Read a single directory, pushing its files onto the Batch and its
+ * subdirectories onto the queue.  Except for the roots, it's opened
+ * relative to its parent, and not if it has become a symbolic link.
+ */
+bool Walk::readdir(const Dir& d)
+{
+    const std::string& path = d.path;
+    const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    const int fd = d.parent
+	? openat(d.parent->fd(), path.substr(path.rfind('/') + 1).c_str(), flags)
+	: open(path.c_str(), flags & ~O_NOFOLLOW);
+    if (fd==-1) {
+	std::cerr << path << ": " << std::strerror(errno) << '\n';
+	return false;
+    }
+
+    struct stat st;
+    DIR* const dir = fstat(fd, &st)==0 ? fdopendir(fd) : nullptr;
+    if (!dir) {
+	std::cerr << path << ": " << std::strerror(errno) << '\n';
+	close(fd);
+	return false;
+    }
+    const auto parent = std::make_shared<const Parent>(dir);
+    const dev_t dev = st.st_dev;
+
+    std::vector<Dir> subdirs;
+    while (true) {
+	errno = 0;
+	const dirent* const ent = ::readdir(dir);
+	if (!ent) break;
+
+	const char* const name = ent->d_name;
+	if (dots(name)) continue;
+
+	unsigned type = ent->d_type;
+	bool stated = false;
+	if (type==DT_UNKNOWN) {
+	    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW)==0) {
+		stated = true;
+		if (S_ISREG(st.st_mode)) type = DT_REG;
+		if (S_ISDIR(st.st_mode)) type = DT_DIR;
+	    }
+	}
+
+	if (type==DT_DIR) {
+	    subdirs.push_back({join(path, name), parent});
+	}
+	else if (type==DT_REG && filter(name)) {
+	    /* only a file with several links can be one we've seen */
+	    if (!stated && fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW)) {
+		st.st_nlink = 1;
+	    }
+	    if (st.st_nlink < 2 || first(dev, ent->d_ino)) {
+		batch.push(join(path, name));
+	    }
+	}
+    }
+    const int err = errno;
+
+    if (!subdirs.empty()) {
+	std::lock_guard<std::mutex> lock {mutex};
+	dirs.insert(end(dirs),
+		    std::make_move_iterator(subdirs.rbegin()),
+		    std::make_move_iterator(subdirs.rend()));
+	work.notify_all();
+    }
+
+    if (err) {
+	std::cerr << path << ": " << std::strerror(err) << '\n';
+	return false;
+    }
+    return true;
+}
+
+/**
+ * True if this is the first time we see the file (dev, ino), which
+ * has more than one link.
+ */
+bool Walk::first(dev_t dev, ino_t ino)
+{
+    std::lock_guard<std::mutex> lock {mutex};
+    return seen.emplace(dev, ino).second;
+}
@@ -0,0 +1,103 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_WALK_H
+#define ANYDIM_WALK_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+
+#include <sys/types.h>
+
+class Batch;
+
+/**
+ * Which file names to probe, judging by the names alone: names with
+ * one of a set of extensions (like "jpg"; case doesn't matter), or
+ * names matching one of a set of fnmatch(3) globs.  If there are
+ * neither extensions nor globs, every name matches.
+ */
+class Filter {
+public:
+    void ext(const std::string& list);
+    void glob(const std::string& pattern);
+
+    bool operator() (const char* name) const;
+
+private:
+    std::vector<std::string> exts;
+    std::vector<std::string> globs;
+};
+
+/**
+ * Recursive traversal of directory trees, pushing the regular files
+ * found onto a Batch.
+ *
+ * The traversal tries to be cheap: directories are opened with
+ * openat(2) relative to their already open parent and read with
+ * readdir(3) (i.e. getdents(2)), the d_type from there decides
+ * what's a file and what's a directory, and names are matched
+ * against the Filter before anything is opened.
+ *
+ * Files which are hard links to an inode already seen are skipped.
+ * That costs an fstatat(2) per matching file, since the link count
+ * isn't in the directory entry, but it reads the inode the probe
+ * will read anyway.  Only files with more than one link are
+ * remembered, so the set of inodes seen (and the lock around it)
+ * stays small even for huge trees.
+ *
+ * Symbolic links are not followed.
+ *
+ * Directories are read by 'n' threads in parallel, so one huge or
+ * slow directory doesn't stall the whole walk.
+ */
+class Walk {
+public:
+    Walk(Batch& batch, const Filter& filter, unsigned n);
+    Walk(const Walk&) = delete;
+    Walk& operator= (const Walk&) = delete;
+
+    bool walk(const std::vector<std::string>& roots);
+
+private:
+    Batch& batch;
+    const Filter& filter;
+    const unsigned n;
+
+    struct Hash {
+	size_t operator() (const std::pair<dev_t, ino_t>& key) const;
+    };
+
+    struct Parent;
+
+    /**
+     * A directory to read: its path, and its parent, which is kept
+     * open until its subdirectories have all been opened.  A root
+     * has no parent.
+     */
+    struct Dir {
+	std::string path;
+	std::shared_ptr<const Parent> parent;
+    };
+
+    std::mutex mutex;
+    std::condition_variable work;
+    std::deque<Dir> dirs;
+    unsigned busy = 0;
+    std::unordered_set<std::pair<dev_t, ino_t>, Hash> seen;
+    bool ok = true;
+
+    void run();
+    bool readdir(const Dir& dir);
+    bool first(dev_t dev, ino_t ino);
+};
+
+#endif
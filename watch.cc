@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "watch.h"
+#include "walk.h"
+#include "batch.h"
+
+#include <iostream>
+#include <unordered_set>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+
+namespace {
+
+    std::string join(const std::string& dir, const char* name)
+    {
+	if (!dir.empty() && dir.back()=='/') return dir + name;
+	return dir + '/' + name;
+    }
+
+    bool before(const timespec& a, const timespec& b)
+    {
+	if (a.tv_sec!=b.tv_sec) return a.tv_sec < b.tv_sec;
+	return a.tv_nsec < b.tv_nsec;
+    }
+
+    timespec now()
+    {
+	timespec t;
+	clock_gettime(CLOCK_REALTIME, &t);
+	return t;
+    }
+
+    /**
+     * True if 'name' in 'dfd' is open for writing by someone, as far
+     * as we can tell: a read lease can't be had then.  We can only
+     * take leases on our own files (or with CAP_LEASE), and not on
+     * every file system; if we can't, the file is assumed complete.
+     */
+    bool writing(int dfd, const char* name)
+    {
+	const int fd = openat(dfd, name,
+			      O_RDONLY | O_NONBLOCK | O_NOFOLLOW | O_CLOEXEC);
+	if (fd==-1) return errno==EWOULDBLOCK;
+	bool busy = false;
+	if (fcntl(fd, F_SETLEASE, F_RDLCK)==0) fcntl(fd, F_SETLEASE, F_UNLCK);
+	else busy = errno==EAGAIN;
+	close(fd);
+	return busy;
+    }
+}
+
+
+Watch::Watch(Batch& batch, const Filter& filter)
+    : batch {batch},
+      filter {filter},
+      fd {inotify_init1(IN_CLOEXEC)}
+{}
+
+Watch::~Watch()
+{
+    if (fd!=-1) close(fd);
+}
+
+bool Watch::watch(const std::vector<std::string>& dirs)
+{
+    if (fd==-1) {
+	std::cerr << "inotify: " << std::strerror(errno) << '\n';
+	return false;
+    }
+
+    bool ok = true;
+    for (const auto& dir : dirs) {
+	const int wd = inotify_add_watch(fd, dir.c_str(),
+					 IN_CLOSE_WRITE | IN_MOVED_TO |
+					 IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+					 IN_ONLYDIR);
+	if (wd==-1) {
+	    std::cerr << dir << ": " << std::strerror(errno) << '\n';
+	    ok = false;
+	    continue;
+	}
+	watched[wd] = dir;
+    }
+
+    /* When we last read the events, so that after an overflow we
+     * know which files may have been missed.  File timestamps are
+     * coarser than the clock, hence the margin.
+     */
+    timespec last = now();
+    last.tv_sec--;
+
+    alignas(inotify_event) char buf[64 * 1024];
+    std::vector<std::string> files;
+    std::unordered_set<std::string> seen;
+
+    while (!watched.empty()) {
+	const ssize_t n = read(fd, buf, sizeof buf);
+	if (n==-1 && errno==EINTR) continue;
+	if (n <= 0) {
+	    std::cerr << "inotify: " << std::strerror(errno) << '\n';
+	    return false;
+	}
+
+	timespec t = now();
+	t.tv_sec--;
+
+	bool overflow = false;
+	for (const char* p = buf; p < buf + n; ) {
+	    const auto ev = reinterpret_cast<const inotify_event*>(p);
+	    p += sizeof *ev + ev->len;
+
+	    if (ev->mask & IN_Q_OVERFLOW) {
+		overflow = true;
+		continue;
+	    }
+	    if (ev->mask & IN_IGNORED) {
+		watched.erase(ev->wd);
+		continue;
+	    }
+	    if (!ev->len || (ev->mask & IN_ISDIR)) continue;
+	    if (!filter(ev->name)) continue;
+
+	    auto dir = watched.find(ev->wd);
+	    if (dir==end(watched)) continue;
+	    std::string file = join(dir->second, ev->name);
+
+	    /* Created files are still being written; remember them in
+	     * case their IN_CLOSE_WRITE is lost.
+	     */
+	    if (ev->mask & IN_CREATE) {
+		open.insert(std::move(file));
+		continue;
+	    }
+	    open.erase(file);
+	    if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) continue;
+	    if (seen.insert(file).second) files.push_back(std::move(file));
+	}
+
+	for (const auto& file : files) batch.push(file);
+	files.clear();
+	seen.clear();
+
+	if (overflow && !rescan(last)) ok = false;
+	last = t;
+    }
+    return ok;
+}
+
+/**
+ * Push the files in the directories which have changed since 'since',
+ * or were still open for writing then, but aren't anymore.  The ctime
+ * is what counts, since moving a file in doesn't change its mtime.  A
+ * file pushed by an earlier rescan isn't pushed again, unless it has
+ * changed since; that matters when the queue overflows over and over
+ * during a burst.
+ *
+ * The files which are still open for writing are remembered as such,
+ * and the others forgotten.
+ */
+bool Watch::rescan(const timespec& since)
+{
+    for (auto it = begin(rescanned); it!=end(rescanned); ) {
+	if (before(it->second, since)) it = rescanned.erase(it);
+	else ++it;
+    }
+
+    std::unordered_set<std::string> was;
+    std::swap(was, open);
+
+    bool ok = true;
+    for (const auto& wd : watched) {
+	const std::string& path = wd.second;
+	DIR* const dir = opendir(path.c_str());
+	if (!dir) {
+	    std::cerr << path << ": " << std::strerror(errno) << '\n';
+	    ok = false;
+	    continue;
+	}
+	const int dfd = dirfd(dir);
+	while (const dirent* const de = readdir(dir)) {
+	    if (de->d_type!=DT_REG && de->d_type!=DT_UNKNOWN) continue;
+	    if (!filter(de->d_name)) continue;
+	    struct stat st;
+	    if (fstatat(dfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW)) continue;
+	    if (!S_ISREG(st.st_mode)) continue;
+
+	    std::string file = join(path, de->d_name);
+	    if (before(st.st_ctim, since) && !was.count(file)) continue;
+	    if (writing(dfd, de->d_name)) {
+		open.insert(std::move(file));
+		continue;
+	    }
+	    auto& ctime = rescanned[file];
+	    if (!before(ctime, st.st_ctim)) continue;
+	    ctime = st.st_ctim;
+	    batch.push(file);
+	}
+	closedir(dir);
+    }
+    return ok;
+}
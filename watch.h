@@ -0,0 +1,58 @@
+/* -*- c++ -*-
+ *
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef ANYDIM_WATCH_H
+#define ANYDIM_WATCH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <time.h>
+
+class Batch;
+class Filter;
+
+/**
+ * Watching directories (not recursively) with inotify(7), and pushing
+ * files onto a Batch as they are completed there: when a file open
+ * for writing is closed, or a file is moved in.  That's how a spool
+ * directory is normally filled, so there's no need to poll it.
+ *
+ * The events are read many at a time, so a burst of files costs few
+ * system calls.  If the kernel's event queue overflows and events are
+ * lost, the directories are read instead, and the files which may
+ * have been completed meanwhile are pushed: those changed since the
+ * last read of events, and those created earlier but not yet closed
+ * then.  A file still open for writing is left for its own event.  A
+ * few files may be pushed twice.  Files already there when the watch
+ * starts are not pushed.
+ *
+ * watch() returns when none of the directories exist anymore (or
+ * when the inotify file descriptor fails), false if anything failed.
+ */
+class Watch {
+public:
+    Watch(Batch& batch, const Filter& filter);
+    ~Watch();
+    Watch(const Watch&) = delete;
+    Watch& operator= (const Watch&) = delete;
+
+    bool watch(const std::vector<std::string>& dirs);
+
+private:
+    Batch& batch;
+    const Filter& filter;
+    const int fd;
+    std::map<int, std::string> watched;
+    std::unordered_map<std::string, timespec> rescanned;
+    std::unordered_set<std::string> open;
+
+    bool rescan(const timespec& since);
+};
+
+#endif
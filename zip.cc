@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2026 Jörgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "archive.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+using anydim::Result;
+
+
+namespace {
+
+    /* Little-endian, unlike the rest of the image world. */
+    unsigned get16(const uint8_t* p)
+    {
+	return p[0] | p[1] << 8;
+    }
+
+    uint32_t get32(const uint8_t* p)
+    {
+	return get16(p) | uint32_t(get16(p + 2)) << 16;
+    }
+
+    uint64_t get64(const uint8_t* p)
+    {
+	return get32(p) | uint64_t(get32(p + 4)) << 32;
+    }
+
+    const uint32_t eocd_sig = 0x06054b50;
+    const uint32_t eocd64_sig = 0x06064b50;
+    const uint32_t locator_sig = 0x07064b50;
+    const uint32_t central_sig = 0x02014b50;
+    const uint32_t local_sig = 0x04034b50;
+
+    /**
+     * pread(2) all of [a, a+n), or as much as there is before EOF.
+     * Returns the number of octets read, or -1.
+     */
+    ssize_t get(int fd, uint8_t* a, size_t n, uint64_t offset)
+    {
+	size_t m = 0;
+	while (m < n) {
+	    const ssize_t rc = pread(fd, a + m, n - m, offset + m);
+	    if (rc==-1 && errno==EINTR) continue;
+	    if (rc==-1) return -1;
+	    if (rc==0) break;
+	    m += rc;
+	}
+	return m;
+    }
+
+    /**
+     * An entry in the central directory.
+     */
+    struct Entry {
+	std::string name;
+	unsigned flags;
+	unsigned method;
+	uint64_t csize;
+	uint64_t offset;
+    };
+
+    /**
+     * Where the central directory is, and how many entries it has,
+     * according to the end of central directory record (and its
+     * ZIP64 version, if needed).  Returns 0 or an errno.
+     */
+    int directory(int fd, uint64_t& offset, uint64_t& size, uint64_t& entries)
+    {
+	struct stat st;
+	if (fstat(fd, &st)) return errno;
+	if (!S_ISREG(st.st_mode)) return ESPIPE;
+	const uint64_t len = st.st_size;
+	if (len < 22) return EINVAL;
+
+	/* the record is 22 octets plus a comment of up to 64K */
+	const uint64_t tail = std::min(len, uint64_t(22 + 0xffff + 20));
+	std::vector<uint8_t> buf(tail);
+	const ssize_t n = get(fd, buf.data(), tail, len - tail);
+	if (n==-1) return errno;
+	if (n!=ssize_t(tail)) return EINVAL;
+
+	size_t i = tail - 22;
+	while (get32(&buf[i])!=eocd_sig) {
+	    if (!i--) return EINVAL;
+	}
+	const uint8_t* const e = &buf[i];
+	entries = get16(e + 10);
+	size = get32(e + 12);
+	offset = get32(e + 16);
+
+	if (entries!=0xffff && size!=0xffffffff && offset!=0xffffffff) {
+	    return 0;
+	}
+
+	/* ZIP64: a locator right before, pointing to another record */
+	if (i < 20 || get32(e - 20)!=locator_sig) return EINVAL;
+	uint8_t e64[56];
+	const ssize_t m = get(fd, e64, sizeof e64, get64(e - 20 + 8));
+	if (m==-1) return errno;
+	if (m!=sizeof e64) return EINVAL;
+	if (get32(e64)!=eocd64_sig) return EINVAL;
+	entries = get64(e64 + 32);
+	size = get64(e64 + 40);
+	offset = get64(e64 + 48);
+	return 0;
+    }
+
+    /**
+     * Parse the central directory in [a, b) into 'entries'.
+     */
+    bool parse(const uint8_t* a, const uint8_t* const b,
+	       std::vector<Entry>& entries)
+    {
+	while (b - a >= 46 && get32(a)==central_sig) {
+	    Entry ent;
+	    ent.flags = get16(a + 8);
+	    ent.method = get16(a + 10);
+	    ent.csize = get32(a + 20);
+	    uint64_t usize = get32(a + 24);
+	    const unsigned namelen = get16(a + 28);
+	    const unsigned extralen = get16(a + 30);
+	    const unsigned commentlen = get16(a + 32);
+	    ent.offset = get32(a + 42);
+	    a += 46;
+	    if (unsigned(b - a) < namelen + extralen + commentlen) return false;
+
+	    ent.name.assign(a, a + namelen);
+	    a += namelen;
+
+	    /* ZIP64 extra field: the sizes and offset which didn't fit */
+	    const uint8_t* x = a;
+	    const uint8_t* const xend = a + extralen;
+	    while (xend - x >= 4) {
+		const unsigned id = get16(x);
+		const unsigned len = get16(x + 2);
+		x += 4;
+		if (unsigned(xend - x) < len) break;
+		if (id==0x0001) {
+		    const uint8_t* p = x;
+		    const uint8_t* const pend = x + len;
+		    auto big = [&p, pend] (uint64_t& val) {
+				   if (val!=0xffffffff || pend - p < 8) return;
+				   val = get64(p);
+				   p += 8;
+			       };
+		    big(usize);
+		    big(ent.csize);
+		    big(ent.offset);
+		}
+		x += len;
+	    }
+	    a = xend + commentlen;
+
+	    if (!ent.name.empty() && ent.name.back()=='/') continue;
+	    entries.push_back(ent);
+	}
+	return true;
+    }
+
+    /**
+     * Raw inflate, for feeding an AnyDim; what it can skip is
+     * inflated, but not fed.
+     */
+    class Inflate {
+    public:
+	Inflate()
+	{
+	    std::memset(&z, 0, sizeof z);
+	    ok = inflateInit2(&z, -MAX_WBITS)==Z_OK;
+	}
+	~Inflate() { if (ok) inflateEnd(&z); }
+
+	bool feed(const uint8_t* a, const uint8_t* b, anydim::AnyDim& dim);
+
+    private:
+	z_stream z;
+	bool ok;
+	bool end = false;
+	size_t skip = 0;
+
+	void pass(const uint8_t* a, const uint8_t* b, anydim::AnyDim& dim);
+    };
+
+    bool Inflate::feed(const uint8_t* a, const uint8_t* b, anydim::AnyDim& dim)
+    {
+	if (!ok) return false;
+	z.next_in = const_cast<uint8_t*>(a);
+	z.avail_in = b - a;
+	uint8_t buf[4096];
+	while (!end && dim.undecided()) {
+	    z.next_out = buf;
+	    z.avail_out = sizeof buf;
+	    const int rc = inflate(&z, Z_NO_FLUSH);
+	    if (rc==Z_STREAM_END) end = true;
+	    else if (rc!=Z_OK && rc!=Z_BUF_ERROR) return false;
+	    pass(buf, z.next_out, dim);
+	    if (z.avail_out) break;
+	}
+	return true;
+    }
+
+    void Inflate::pass(const uint8_t* a, const uint8_t* b, anydim::AnyDim& dim)
+    {
+	while (a!=b && dim.undecided()) {
+	    const size_t n = std::min(skip, size_t(b - a));
+	    if (n) {
+		dim.skip(n);
+		skip -= n;
+		a += n;
+		continue;
+	    }
+	    dim.feed(a, b);
+	    a = b;
+	    if (dim.undecided()) skip = dim.skippable();
+	}
+    }
+
+    /**
+     * Probe one member: a pread of its local header and the start of
+     * its data, and more only if the decoders need it.
+     */
+    int probe(int fd, const Entry& ent, const anydim::Options& options,
+	      Result& res)
+    {
+	if (ent.flags & 1) return ENOTSUP;	/* encrypted */
+	if (ent.method!=0 && ent.method!=8) return ENOTSUP;
+
+	uint8_t buf[4096];
+	ssize_t n = get(fd, buf, sizeof buf, ent.offset);
+	if (n==-1) return errno;
+	if (n < 30 || get32(buf)!=local_sig) return EINVAL;
+	uint64_t offset = ent.offset + 30 + get16(buf + 26) + get16(buf + 28);
+	const uint64_t end = offset + ent.csize;
+
+	anydim::AnyDim dim {options.use_exif, options.max_octets, options.memo};
+	Inflate inflate;
+
+	/* what's left of the first read, then more reads */
+	const uint8_t* a = buf + std::min(uint64_t(n), offset - ent.offset);
+	n = buf + n - a;
+	res.tally(ent.offset, a - buf + n);
+	while (dim.undecided() && offset < end) {
+	    if (!n) {
+		size_t len = ent.method ? sizeof buf : dim.want();
+		if (!len || len > sizeof buf) len = sizeof buf;
+		len = std::min(uint64_t(len), end - offset);
+		n = get(fd, buf, len, offset);
+		if (n==-1) return errno;
+		if (n==0) return EINVAL;
+		res.tally(offset, n);
+		a = buf;
+	    }
+	    const uint8_t* const b = a + std::min(uint64_t(n), end - offset);
+	    if (ent.method) {
+		if (!inflate.feed(a, b, dim)) return EINVAL;
+	    }
+	    else {
+		dim.feed(a, b);
+		const size_t skip = dim.undecided() ? dim.skippable() : 0;
+		dim.skip(skip);
+		offset += skip;
+	    }
+	    offset += b - a;
+	    n = 0;
+	}
+	if (dim.undecided()) dim.eof();
+	res.decided(dim);
+	return 0;
+    }
+}
+
+
+int anydim::probe_zip(int fd, const Options& options, const Member& member)
+{
+    uint64_t offset = 0, size = 0, count = 0;
+    if (const int err = directory(fd, offset, size, count)) return err;
+    if (size > 1 << 30) return EINVAL;
+
+    std::vector<uint8_t> buf(size);
+    const ssize_t n = get(fd, buf.data(), size, offset);
+    if (n==-1) return errno;
+    if (n!=ssize_t(size)) return EINVAL;
+
+    std::vector<Entry> entries;
+    entries.reserve(std::min(count, uint64_t(1 << 16)));
+    if (!parse(buf.data(), buf.data() + size, entries)) return EINVAL;
+    buf.clear();
+    buf.shrink_to_fit();
+
+    for (const Entry& ent : entries) {
+	Result res;
+	const int err = probe(fd, ent, options, res);
+	if (err && err!=EINVAL && err!=ENOTSUP) return err;
+	if (err==EINVAL) res.bad = true;
+	else res.error = err;
+	member(ent.name, res);
+    }
+    return 0;
+}